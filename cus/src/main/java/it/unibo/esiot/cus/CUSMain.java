@@ -63,13 +63,18 @@ public class CUSMain {
     private void setDefaultConfiguration() {
         config.setProperty("mqtt.broker", "tcp://localhost:1883");
         config.setProperty("mqtt.topic.level", "tank/level");
+        config.setProperty("mqtt.format", "text");
+        config.setProperty("mqtt.topic.alert", "tank/1/alert");
         config.setProperty("serial.port", "COM3");
         config.setProperty("serial.baudrate", "9600");
+        config.setProperty("serial.protocol", "auto");
+        config.setProperty("serial.fastbaud", "250000");
         config.setProperty("http.port", "8080");
         config.setProperty("tank.l1", "20");
         config.setProperty("tank.l2", "40");
         config.setProperty("tank.t1", "10000");
         config.setProperty("tank.t2", "10000");
+        config.setProperty("control.local", "true");
         config.setProperty("history.size", "100");
     }
 
@@ -82,13 +87,17 @@ public class CUSMain {
         // Initialize MQTT service for TMS communication
         String mqttBroker = config.getProperty("mqtt.broker");
         String mqttTopic = config.getProperty("mqtt.topic.level");
-        mqttService = new MQTTService(mqttBroker, mqttTopic, systemState);
+        boolean mqttBinary = config.getProperty("mqtt.format", "text").equals("binary");
+        String mqttAlertTopic = config.getProperty("mqtt.topic.alert");
+        mqttService = new MQTTService(mqttBroker, mqttTopic, mqttAlertTopic, systemState, mqttBinary);
         System.out.println("✓ MQTT Service initialized");
 
         // Initialize Serial service for WCS communication
         String serialPort = config.getProperty("serial.port");
         int baudRate = Integer.parseInt(config.getProperty("serial.baudrate"));
-        serialService = new SerialService(serialPort, baudRate, systemState);
+        boolean negotiate = config.getProperty("serial.protocol", "auto").equals("auto");
+        int fastBaudRate = Integer.parseInt(config.getProperty("serial.fastbaud", "250000"));
+        serialService = new SerialService(serialPort, baudRate, systemState, negotiate, fastBaudRate);
         System.out.println("✓ Serial Service initialized");
 
         // Initialize HTTP service for DBS communication
@@ -102,6 +111,13 @@ public class CUSMain {
         long t1 = Long.parseLong(config.getProperty("tank.t1"));
         long t2 = Long.parseLong(config.getProperty("tank.t2"));
         tankMonitor = new TankMonitor(systemState, serialService, l1, l2, t1, t2);
+        mqttService.setAlertListener(tankMonitor::requestUpdate);
+        if (Boolean.parseBoolean(config.getProperty("control.local", "false"))) {
+            // Levels and policy go to the WCS, which then runs the policy itself
+            serialService.setLocalPolicy(l1, l2, t1);
+            mqttService.setLevelListener(serialService::sendLevelSample);
+            System.out.println("✓ Local control on the WCS enabled");
+        }
         System.out.println("✓ Tank Monitor initialized");
 
         System.out.println("All services initialized successfully\n");
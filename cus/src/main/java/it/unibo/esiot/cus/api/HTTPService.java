@@ -71,7 +71,14 @@ public class HTTPService {
         status.put("mode", mode.toString());
         status.put("waterLevel", systemState.getCurrentWaterLevel());
         status.put("valveOpening", systemState.getCurrentValveOpening());
+        status.put("valveCommand", systemState.getValveCommand());
+        status.put("valveSettleMs", systemState.getValveSettleMs());
+        status.put("wcsLoopMaxUs", systemState.getWcsLoopMaxUs());
+        status.put("wcsLoopOverruns", systemState.getWcsLoopOverruns());
+        status.put("wcsTasks", systemState.getWcsTaskTimings());
+        status.put("commandLatency", systemState.getCommandLatency());
         status.put("tmsConnected", systemState.isTMSConnected(10000));
+        status.put("edgeAlarm", systemState.getEdgeAlarm());
         status.put("timestamp", System.currentTimeMillis());
 
         ctx.json(status);
@@ -150,9 +157,8 @@ public class HTTPService {
 
             System.out.println("[HTTP] Manual valve control: " + opening + "%");
 
-            // Send command to WCS
+            // Send command to WCS (valveOpening follows the WCS status once applied)
             serialService.sendValveCommand(opening);
-            systemState.setCurrentValveOpening(opening);
 
             ctx.json(Map.of("success", true, "opening", opening));
 
@@ -0,0 +1,91 @@
+package it.unibo.esiot.cus.comm;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * BinaryTelemetry - Decoder for the TMS batched binary payload (tank/level/bin)
+ * 
+ * Layout (version 1, little-endian):
+ * version u8, count u8, deviceId u16, firstSeq u32, baseTimeMs u32,
+ * baseLevel u16 (0.01 cm), then (count - 1) x { dtMs u16, dLevel i16 }
+ */
+public class BinaryTelemetry {
+
+    public static final int VERSION = 1;
+    private static final int HEADER_SIZE = 14;
+    private static final int SAMPLE_SIZE = 4;
+
+    /**
+     * One decoded sample
+     */
+    public static class Sample {
+        public final long seq;
+        public final long deviceTimeMs;
+        public final float level;
+
+        public Sample(long seq, long deviceTimeMs, float level) {
+            this.seq = seq;
+            this.deviceTimeMs = deviceTimeMs;
+            this.level = level;
+        }
+    }
+
+    public final int deviceId;
+    public final long firstSeq;
+    public final List<Sample> samples;
+
+    private BinaryTelemetry(int deviceId, long firstSeq, List<Sample> samples) {
+        this.deviceId = deviceId;
+        this.firstSeq = firstSeq;
+        this.samples = samples;
+    }
+
+    /**
+     * Decode a payload
+     * 
+     * @throws IllegalArgumentException if the version or size is wrong
+     */
+    public static BinaryTelemetry decode(byte[] payload) {
+        if (payload.length < HEADER_SIZE) {
+            throw new IllegalArgumentException("Payload too short: " + payload.length);
+        }
+
+        ByteBuffer buffer = ByteBuffer.wrap(payload).order(ByteOrder.LITTLE_ENDIAN);
+        int version = Byte.toUnsignedInt(buffer.get());
+        int count = Byte.toUnsignedInt(buffer.get());
+        if (version != VERSION) {
+            throw new IllegalArgumentException("Unsupported version: " + version);
+        }
+        if (count == 0 || payload.length != HEADER_SIZE + SAMPLE_SIZE * (count - 1)) {
+            throw new IllegalArgumentException("Bad size for " + count + " samples: " + payload.length);
+        }
+
+        int deviceId = Short.toUnsignedInt(buffer.getShort());
+        long seq = Integer.toUnsignedLong(buffer.getInt());
+        long timeMs = Integer.toUnsignedLong(buffer.getInt());
+        int level = Short.toUnsignedInt(buffer.getShort());
+
+        List<Sample> samples = new ArrayList<>(count);
+        long firstSeq = seq;
+        samples.add(new Sample(seq, timeMs, level / 100.0f));
+
+        for (int i = 1; i < count; i++) {
+            timeMs += Short.toUnsignedInt(buffer.getShort());
+            level += buffer.getShort();
+            seq++;
+            samples.add(new Sample(seq, timeMs, level / 100.0f));
+        }
+
+        return new BinaryTelemetry(deviceId, firstSeq, samples);
+    }
+
+    /**
+     * Sequence number expected in the next batch from the same device
+     */
+    public long nextSeq() {
+        return (firstSeq + samples.size()) & 0xFFFFFFFFL;
+    }
+}
@@ -0,0 +1,211 @@
+package it.unibo.esiot.cus.comm;
+
+import it.unibo.esiot.cus.model.SystemState;
+import it.unibo.esiot.cus.model.SystemState.CommandLatency;
+
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Iterator;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+
+/**
+ * CommandTracker - In-flight WCS commands and their round-trip times
+ *
+ * Every command gets a 16-bit id that the WCS echoes in its ack or nack.
+ * A command without an answer after COMMAND_TIMEOUT_MS is resent with the
+ * same id, up to MAX_ATTEMPTS sends in total; a nack because the WCS was
+ * not connected yet is resent at once. A newer command of the same type
+ * replaces one still in flight, so a late retry can never undo it.
+ * RTTs are measured from the first send and published per command type.
+ */
+public class CommandTracker {
+
+    public static final long COMMAND_TIMEOUT_MS = 500;
+    public static final int MAX_ATTEMPTS = 4;
+    private static final int RTT_WINDOW = 200; // Samples kept per type for the percentiles
+
+    // WCS command results (CMD_* in wcs/src/task/Protocol.h)
+    public static final int RESULT_OK = 0;
+    public static final int RESULT_UNCONNECTED = 1;
+    public static final int RESULT_BAD_VALUE = 2;
+    public static final int RESULT_UNKNOWN = 3;
+
+    /**
+     * A command waiting for its ack
+     */
+    public static class PendingCommand {
+        public final int id;
+        public final String type; // "set_valve" or "set_mode"
+        public final int value; // Valve percentage or WCS mode code
+        final long firstSentNs;
+        long lastSentNs;
+        int attempts;
+
+        PendingCommand(int id, String type, int value, long nowNs) {
+            this.id = id;
+            this.type = type;
+            this.value = value;
+            this.firstSentNs = nowNs;
+        }
+
+        public int getAttempts() {
+            return attempts;
+        }
+    }
+
+    /**
+     * Counters and recent RTTs of one command type
+     */
+    private static class TypeStats {
+        final long[] rttUs = new long[RTT_WINDOW];
+        int samples = 0;
+        int next = 0;
+        int sent = 0;
+        int acked = 0;
+        int nacked = 0;
+        int failed = 0;
+        int retries = 0;
+        int wcsMaxUs = 0;
+
+        void addRtt(long us) {
+            rttUs[next] = us;
+            next = (next + 1) % RTT_WINDOW;
+            samples = Math.min(samples + 1, RTT_WINDOW);
+        }
+
+        CommandLatency snapshot() {
+            long[] sorted = Arrays.copyOf(rttUs, samples);
+            Arrays.sort(sorted);
+            return new CommandLatency(sent, acked, nacked, failed, retries,
+                    percentileMs(sorted, 50), percentileMs(sorted, 90), percentileMs(sorted, 99),
+                    samples > 0 ? sorted[samples - 1] / 1000.0 : 0, wcsMaxUs);
+        }
+
+        /**
+         * Nearest-rank percentile in ms
+         */
+        private static double percentileMs(long[] sorted, int percentile) {
+            if (sorted.length == 0) {
+                return 0;
+            }
+            int rank = (int) Math.ceil(percentile / 100.0 * sorted.length);
+            return sorted[Math.max(rank, 1) - 1] / 1000.0;
+        }
+    }
+
+    private final SystemState systemState;
+    private final Map<Integer, PendingCommand> inFlight = new LinkedHashMap<>();
+    private final Map<String, TypeStats> stats = new LinkedHashMap<>();
+    private int nextId = 1;
+
+    public CommandTracker(SystemState systemState) {
+        this.systemState = systemState;
+    }
+
+    /**
+     * Register a new command, replacing any in-flight one of the same type
+     *
+     * @return The command to send, or null if the same command is already in flight
+     */
+    public synchronized PendingCommand create(String type, int value) {
+        Iterator<PendingCommand> it = inFlight.values().iterator();
+        while (it.hasNext()) {
+            PendingCommand pending = it.next();
+            if (pending.type.equals(type)) {
+                if (pending.value == value) {
+                    return null;
+                }
+                it.remove();
+            }
+        }
+
+        int id = nextId;
+        nextId = nextId % 0xFFFF + 1; // 1..65535, 0 is never used
+        PendingCommand command = new PendingCommand(id, type, value, System.nanoTime());
+        inFlight.put(id, command);
+        stats(type).sent++;
+        return command;
+    }
+
+    /**
+     * Record one transmission of a command
+     */
+    public synchronized void markSent(PendingCommand command) {
+        command.lastSentNs = System.nanoTime();
+        command.attempts++;
+        if (command.attempts > 1) {
+            stats(command.type).retries++;
+        }
+    }
+
+    /**
+     * Commands to resend now; commands out of attempts are dropped as failed
+     */
+    public synchronized List<PendingCommand> due() {
+        long now = System.nanoTime();
+        List<PendingCommand> resend = new ArrayList<>();
+        Iterator<PendingCommand> it = inFlight.values().iterator();
+        while (it.hasNext()) {
+            PendingCommand command = it.next();
+            if (now - command.lastSentNs < COMMAND_TIMEOUT_MS * 1_000_000L) {
+                continue;
+            }
+            if (command.attempts >= MAX_ATTEMPTS) {
+                it.remove();
+                stats(command.type).failed++;
+                publish(command.type);
+                System.err.println("[Serial] " + command.type + " id " + command.id
+                        + " failed: no answer after " + command.attempts + " attempts");
+            } else {
+                resend.add(command);
+            }
+        }
+        return resend;
+    }
+
+    /**
+     * Apply an ack or nack from the WCS
+     *
+     * @return The answered command, or null for an unknown or superseded id
+     */
+    public synchronized PendingCommand complete(int id, int result, int wcsUs) {
+        PendingCommand command = inFlight.get(id);
+        if (command == null) {
+            return null;
+        }
+        TypeStats typeStats = stats(command.type);
+
+        if (result == RESULT_UNCONNECTED && command.attempts < MAX_ATTEMPTS) {
+            command.lastSentNs = 0; // Due again on the next check
+            return command;
+        }
+
+        inFlight.remove(id);
+        if (result == RESULT_OK) {
+            typeStats.acked++;
+            typeStats.addRtt((System.nanoTime() - command.firstSentNs) / 1000);
+            typeStats.wcsMaxUs = Math.max(typeStats.wcsMaxUs, wcsUs);
+        } else {
+            typeStats.nacked++;
+        }
+        publish(command.type);
+        return command;
+    }
+
+    /**
+     * Whether a command is still waiting for its answer
+     */
+    public synchronized boolean isInFlight(PendingCommand command) {
+        return inFlight.get(command.id) == command;
+    }
+
+    private TypeStats stats(String type) {
+        return stats.computeIfAbsent(type, t -> new TypeStats());
+    }
+
+    private void publish(String type) {
+        systemState.setCommandLatency(type, stats(type).snapshot());
+    }
+}
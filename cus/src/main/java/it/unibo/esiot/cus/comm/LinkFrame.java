@@ -0,0 +1,134 @@
+package it.unibo.esiot.cus.comm;
+
+import java.io.ByteArrayOutputStream;
+import java.util.Arrays;
+
+/**
+ * LinkFrame - Binary frames of the CUS-WCS serial link (wcs/src/task/Protocol.h)
+ *
+ * Wire format: COBS(opcode u8, seq u8, payload, crc16 u16 LE) followed by 0x00,
+ * CRC-16/CCITT-FALSE over opcode to payload
+ */
+public class LinkFrame {
+
+    public static final int PROTOCOL_VERSION = 1;
+
+    // CUS -> WCS (argument byte, then the u16 LE command id)
+    public static final int OP_SET_VALVE = 0x01;
+    public static final int OP_SET_MODE = 0x02;
+    public static final int OP_PING = 0x03;
+    public static final int OP_LEVEL = 0x04; // u16 LE level (0.1 mm)
+    public static final int OP_SET_POLICY = 0x05; // u16 LE L1, u16 LE L2 (0.1 mm), u32 LE T1 ms
+
+    // WCS -> CUS
+    public static final int OP_STATUS = 0x81;
+    public static final int OP_SCHED = 0x82;
+    public static final int OP_ACK = 0x83; // u16 LE id, u8 result, u8 applied value, u16 LE processing us
+
+    // WCS scheduler task ids of OP_SCHED (TaskId order in wcs/src/task/Scheduler.h)
+    public static final String[] WCS_TASK_NAMES = {
+        "serial", "button", "fsm", "valve", "lcd", "lcdflush", "status", "report"
+    };
+
+    public final int opcode;
+    public final int seq;
+    public final byte[] payload;
+
+    public LinkFrame(int opcode, int seq, byte[] payload) {
+        this.opcode = opcode;
+        this.seq = seq;
+        this.payload = payload;
+    }
+
+    /**
+     * Encoded frame including the trailing 0x00 delimiter
+     */
+    public byte[] encode() {
+        byte[] raw = new byte[2 + payload.length + 2];
+        raw[0] = (byte) opcode;
+        raw[1] = (byte) seq;
+        System.arraycopy(payload, 0, raw, 2, payload.length);
+        int crc = crc16(raw, raw.length - 2);
+        raw[raw.length - 2] = (byte) crc;
+        raw[raw.length - 1] = (byte) (crc >> 8);
+
+        byte[] encoded = cobsEncode(raw);
+        byte[] frame = Arrays.copyOf(encoded, encoded.length + 1);
+        frame[encoded.length] = 0;
+        return frame;
+    }
+
+    /**
+     * Decode a frame received between two 0x00 delimiters
+     *
+     * @throws IllegalArgumentException if the encoding or the CRC is wrong
+     */
+    public static LinkFrame decode(byte[] encoded) {
+        byte[] raw = cobsDecode(encoded);
+        if (raw.length < 4) {
+            throw new IllegalArgumentException("Frame too short: " + raw.length);
+        }
+        int length = raw.length - 2;
+        int crc = Byte.toUnsignedInt(raw[length]) | (Byte.toUnsignedInt(raw[length + 1]) << 8);
+        if (crc != crc16(raw, length)) {
+            throw new IllegalArgumentException("CRC mismatch");
+        }
+        return new LinkFrame(Byte.toUnsignedInt(raw[0]), Byte.toUnsignedInt(raw[1]),
+                Arrays.copyOfRange(raw, 2, length));
+    }
+
+    /**
+     * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+     */
+    public static int crc16(byte[] data, int length) {
+        int crc = 0xFFFF;
+        for (int i = 0; i < length; i++) {
+            crc ^= Byte.toUnsignedInt(data[i]) << 8;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x8000) != 0 ? ((crc << 1) ^ 0x1021) : (crc << 1);
+                crc &= 0xFFFF;
+            }
+        }
+        return crc;
+    }
+
+    static byte[] cobsEncode(byte[] input) {
+        ByteArrayOutputStream out = new ByteArrayOutputStream(input.length + 2);
+        byte[] block = new byte[255];
+        int code = 1;
+        for (byte b : input) {
+            if (b == 0) {
+                out.write(code);
+                out.write(block, 1, code - 1);
+                code = 1;
+            } else {
+                block[code++] = b;
+                if (code == 0xFF) {
+                    out.write(code);
+                    out.write(block, 1, code - 1);
+                    code = 1;
+                }
+            }
+        }
+        out.write(code);
+        out.write(block, 1, code - 1);
+        return out.toByteArray();
+    }
+
+    static byte[] cobsDecode(byte[] input) {
+        ByteArrayOutputStream out = new ByteArrayOutputStream(input.length);
+        int in = 0;
+        while (in < input.length) {
+            int code = Byte.toUnsignedInt(input[in++]);
+            if (code == 0 || in + code - 1 > input.length) {
+                throw new IllegalArgumentException("Bad COBS encoding");
+            }
+            out.write(input, in, code - 1);
+            in += code - 1;
+            if (code < 0xFF && in < input.length) {
+                out.write(0);
+            }
+        }
+        return out.toByteArray();
+    }
+}
@@ -1,8 +1,17 @@
 package it.unibo.esiot.cus.comm;
 
+import com.google.gson.Gson;
+import com.google.gson.JsonArray;
+import com.google.gson.JsonElement;
+import com.google.gson.JsonObject;
 import it.unibo.esiot.cus.model.SystemState;
+import it.unibo.esiot.cus.model.SystemState.WaterLevelReading;
 import org.eclipse.paho.client.mqttv3.*;
 
+import java.util.ArrayList;
+import java.util.List;
+import java.util.function.Consumer;
+
 /**
  * MQTTService - MQTT Client for TMS Communication
  * 
@@ -13,15 +22,47 @@ public class MQTTService implements Runnable {
 
     private final String brokerUrl;
     private final String topic;
+    private final String backfillTopic;
+    private final String binaryTopic;
+    private final String alertTopic;
+    private final boolean binaryFormat;
     private final SystemState systemState;
+    private final Gson gson;
+
+    // Loss detection for binary telemetry (seq gaps not filled by backfill)
+    private final SampleLossTracker sampleLoss = new SampleLossTracker();
+    private int binaryDeviceId = -1;
+
+    // Notified when an edge alert arrives, so the policy runs without waiting for its next poll
+    private volatile Runnable alertListener;
+    private volatile Consumer<Float> levelListener;
 
     private MqttClient mqttClient;
     private volatile boolean running = false;
 
     public MQTTService(String brokerUrl, String topic, SystemState systemState) {
+        this(brokerUrl, topic, systemState, false);
+    }
+
+    public MQTTService(String brokerUrl, String topic, SystemState systemState, boolean binaryFormat) {
+        this(brokerUrl, topic, null, systemState, binaryFormat);
+    }
+
+    /**
+     * @param alertTopic   topic of the TMS edge alarm engine, null to ignore alerts
+     * @param binaryFormat true to take live levels from the batched binary
+     *                     topic (topic + "/bin") instead of the plain-text one
+     */
+    public MQTTService(String brokerUrl, String topic, String alertTopic, SystemState systemState,
+            boolean binaryFormat) {
         this.brokerUrl = brokerUrl;
         this.topic = topic;
+        this.backfillTopic = topic + "/backfill";
+        this.binaryTopic = topic + "/bin";
+        this.alertTopic = alertTopic;
+        this.binaryFormat = binaryFormat;
         this.systemState = systemState;
+        this.gson = new Gson();
     }
 
     @Override
@@ -64,9 +105,14 @@ public class MQTTService implements Runnable {
             mqttClient.connect(options);
             System.out.println("[MQTT] Connected successfully");
 
-            // Subscribe to topic
-            mqttClient.subscribe(topic, 1); // QoS 1
-            System.out.println("[MQTT] Subscribed to topic: " + topic);
+            // Subscribe to live and backfill topics
+            String liveTopic = binaryFormat ? binaryTopic : topic;
+            mqttClient.subscribe(new String[] { liveTopic, backfillTopic }, new int[] { 1, 1 }); // QoS 1
+            System.out.println("[MQTT] Subscribed to topics: " + liveTopic + ", " + backfillTopic);
+            if (alertTopic != null) {
+                mqttClient.subscribe(alertTopic, 1);
+                System.out.println("[MQTT] Subscribed to alerts: " + alertTopic);
+            }
 
             // Keep thread alive
             while (running) {
@@ -88,6 +134,19 @@ public class MQTTService implements Runnable {
      * Handle incoming MQTT message from TMS
      */
     private void handleIncomingMessage(String topic, MqttMessage message) {
+        if (topic.equals(backfillTopic)) {
+            handleBackfillMessage(message);
+            return;
+        }
+        if (topic.equals(binaryTopic)) {
+            handleBinaryMessage(message);
+            return;
+        }
+        if (topic.equals(alertTopic)) {
+            handleAlertMessage(message);
+            return;
+        }
+
         try {
             String payload = new String(message.getPayload());
             System.out.println("[MQTT] Received: " + payload);
@@ -97,6 +156,7 @@ public class MQTTService implements Runnable {
 
             // Update system state
             systemState.setCurrentWaterLevel(waterLevel);
+            notifyLevel(waterLevel);
 
             // If we were unconnected and now receiving data, switch to automatic
             if (systemState.getCurrentMode() == SystemState.Mode.UNCONNECTED) {
@@ -108,6 +168,141 @@ public class MQTTService implements Runnable {
         }
     }
 
+    /**
+     * Handle a batch of samples the TMS buffered during a network outage
+     * Payload: {"samples":[[seq,age_ms,level],...]}
+     */
+    private void handleBackfillMessage(MqttMessage message) {
+        try {
+            long receivedAt = System.currentTimeMillis();
+            JsonObject json = gson.fromJson(new String(message.getPayload()), JsonObject.class);
+            JsonArray samples = json.getAsJsonArray("samples");
+
+            List<WaterLevelReading> readings = new ArrayList<>();
+            for (JsonElement element : samples) {
+                JsonArray sample = element.getAsJsonArray();
+                sampleLoss.onBackfill(sample.get(0).getAsLong());
+                long ageMs = sample.get(1).getAsLong();
+                float level = sample.get(2).getAsFloat();
+                readings.add(new WaterLevelReading(level, receivedAt - ageMs));
+            }
+
+            systemState.addBackfilledReadings(readings);
+            System.out.println("[MQTT] Backfilled " + readings.size() + " readings");
+
+        } catch (Exception e) {
+            System.err.println("[MQTT] Invalid backfill message: " + e.getMessage());
+        }
+    }
+
+    /**
+     * Handle a batched binary telemetry message
+     * Sequence gaps against the previous batch count as lost unless the
+     * samples arrive as backfill
+     */
+    private void handleBinaryMessage(MqttMessage message) {
+        try {
+            long receivedAt = System.currentTimeMillis();
+            BinaryTelemetry batch = BinaryTelemetry.decode(message.getPayload());
+
+            if (batch.deviceId != binaryDeviceId) {
+                if (binaryDeviceId >= 0) {
+                    System.err.println("[MQTT] Binary telemetry from device " + batch.deviceId
+                            + " after device " + binaryDeviceId + ", one TMS expected");
+                }
+                binaryDeviceId = batch.deviceId;
+            }
+            long missing = sampleLoss.onLiveBatch(batch.firstSeq, batch.nextSeq());
+            if (missing > 0) {
+                System.err.println("[MQTT] Device " + batch.deviceId + ": " + missing
+                        + " samples missing (" + sampleLoss.getLostSamples() + " not backfilled so far)");
+            }
+
+            // Map device uptime to wall clock using the newest sample as "now"
+            BinaryTelemetry.Sample newest = batch.samples.get(batch.samples.size() - 1);
+            List<WaterLevelReading> older = new ArrayList<>();
+            for (BinaryTelemetry.Sample sample : batch.samples) {
+                if (sample != newest) {
+                    older.add(new WaterLevelReading(sample.level,
+                            receivedAt - (newest.deviceTimeMs - sample.deviceTimeMs)));
+                }
+            }
+            systemState.addBackfilledReadings(older);
+            systemState.setCurrentWaterLevel(newest.level);
+            notifyLevel(newest.level);
+
+            if (systemState.getCurrentMode() == SystemState.Mode.UNCONNECTED) {
+                systemState.setCurrentMode(SystemState.Mode.AUTOMATIC);
+            }
+
+        } catch (IllegalArgumentException | java.nio.BufferUnderflowException e) {
+            System.err.println("[MQTT] Invalid binary telemetry: " + e.getMessage());
+        }
+    }
+
+    /**
+     * Handle an alarm state change raised by the TMS right after a sample
+     * Payload: {"seq":..,"state":"..","prev":"..","level":..,"valve":..,"age_ms":..}
+     * A retained alert replayed by the broker on subscribe is an old sample:
+     * it only updates the reported alarm state, not the current level
+     */
+    private void handleAlertMessage(MqttMessage message) {
+        try {
+            JsonObject json = gson.fromJson(new String(message.getPayload()), JsonObject.class);
+            String state = json.get("state").getAsString();
+            float level = json.get("level").getAsFloat();
+            System.out.println("[MQTT] Edge alert: " + json.get("prev").getAsString() + " -> " + state
+                    + " at " + level + " cm" + (message.isRetained() ? " (retained)" : ""));
+
+            systemState.setEdgeAlarm(state);
+            if (message.isRetained()) {
+                return;
+            }
+
+            systemState.setCurrentWaterLevel(level);
+            notifyLevel(level);
+            if (systemState.getCurrentMode() == SystemState.Mode.UNCONNECTED) {
+                systemState.setCurrentMode(SystemState.Mode.AUTOMATIC);
+            }
+
+            Runnable listener = alertListener;
+            if (listener != null) {
+                listener.run();
+            }
+
+        } catch (Exception e) {
+            System.err.println("[MQTT] Invalid alert message: " + e.getMessage());
+        }
+    }
+
+    /**
+     * Register the callback run after each live edge alert
+     */
+    public void setAlertListener(Runnable listener) {
+        this.alertListener = listener;
+    }
+
+    /**
+     * Register the callback run with each live level sample (not backfill)
+     */
+    public void setLevelListener(Consumer<Float> listener) {
+        this.levelListener = listener;
+    }
+
+    private void notifyLevel(float level) {
+        Consumer<Float> listener = levelListener;
+        if (listener != null) {
+            listener.accept(level);
+        }
+    }
+
+    /**
+     * Samples missing from the binary telemetry and not recovered by backfill
+     */
+    public long getLostSamples() {
+        return sampleLoss.getLostSamples();
+    }
+
     /**
      * Stop the MQTT service
      */
@@ -0,0 +1,106 @@
+package it.unibo.esiot.cus.comm;
+
+import java.util.Iterator;
+import java.util.Map;
+import java.util.TreeMap;
+import java.util.TreeSet;
+
+/**
+ * SampleLossTracker - TMS samples missing from both telemetry streams
+ *
+ * Binary batches carry consecutive sequence numbers. A gap between two
+ * batches is not necessarily a loss: samples of a failed publish or taken
+ * during an outage reach the CUS on the backfill topic, before or after the
+ * gap shows up. Only seqs seen in neither stream are counted as lost.
+ * A backwards jump is a TMS restart (seq back to 0), not a loss.
+ * One TMS per CUS: backfill payloads carry no device id.
+ */
+public class SampleLossTracker {
+
+    // Backfilled seqs remembered until the live gap they fill shows up
+    // (more than the TMS offline buffer can hold)
+    private static final int BACKFILL_MEMORY = 32768;
+
+    private long expectedSeq = -1; // Next live seq, -1 before the first batch
+    private final TreeMap<Long, Long> missing = new TreeMap<>(); // Gap start -> end (exclusive)
+    private final TreeSet<Long> backfilled = new TreeSet<>();
+    private long lostSamples = 0; // Sum of the missing ranges, plus gaps before a restart
+
+    /**
+     * Record a live batch
+     *
+     * @return Samples newly found missing (0 if the gap was backfilled already)
+     */
+    public synchronized long onLiveBatch(long firstSeq, long nextSeq) {
+        long added = 0;
+        if (expectedSeq >= 0 && firstSeq != expectedSeq) {
+            if (firstSeq < expectedSeq) {
+                System.out.println("[MQTT] TMS sample sequence restarted at " + firstSeq);
+                missing.clear(); // Earlier gaps stay counted: backfill can no longer be matched to them
+                backfilled.clear();
+            } else {
+                added = addMissing(expectedSeq, firstSeq);
+            }
+        }
+        expectedSeq = nextSeq;
+        return added;
+    }
+
+    /**
+     * Record a sample that arrived on the backfill topic
+     */
+    public synchronized void onBackfill(long seq) {
+        Map.Entry<Long, Long> range = missing.floorEntry(seq);
+        if (range != null && seq < range.getValue()) {
+            // Split the range around the recovered seq
+            missing.remove(range.getKey());
+            if (range.getKey() < seq) {
+                missing.put(range.getKey(), seq);
+            }
+            if (seq + 1 < range.getValue()) {
+                missing.put(seq + 1, range.getValue());
+            }
+            lostSamples--;
+            return;
+        }
+        if (expectedSeq < 0 || seq >= expectedSeq) {
+            // Ahead of the live stream: its gap is still to come
+            backfilled.add(seq);
+            if (backfilled.size() > BACKFILL_MEMORY) {
+                backfilled.pollFirst();
+            }
+        }
+    }
+
+    /**
+     * Samples seen in neither stream so far
+     */
+    public synchronized long getLostSamples() {
+        return lostSamples;
+    }
+
+    /**
+     * Add the gap [start, end), minus the seqs already backfilled
+     */
+    private long addMissing(long start, long end) {
+        long added = 0;
+        long from = start;
+        Iterator<Long> it = backfilled.subSet(start, end).iterator();
+        while (it.hasNext()) {
+            long seq = it.next();
+            it.remove();
+            if (from < seq) {
+                missing.put(from, seq);
+                added += seq - from;
+            }
+            from = seq + 1;
+        }
+        if (from < end) {
+            missing.put(from, end);
+            added += end - from;
+        }
+        backfilled.headSet(end).clear(); // Older ones can no longer fill a gap
+        lostSamples += added;
+        return added;
+    }
+}
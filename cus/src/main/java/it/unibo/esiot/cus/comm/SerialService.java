@@ -5,34 +5,89 @@ import com.google.gson.Gson;
 import com.google.gson.JsonObject;
 import it.unibo.esiot.cus.model.SystemState;
 
-import java.io.BufferedReader;
-import java.io.InputStreamReader;
+import java.io.ByteArrayOutputStream;
+import java.io.InputStream;
+import java.io.OutputStream;
 import java.io.PrintWriter;
+import java.nio.charset.StandardCharsets;
 
 /**
  * SerialService - Serial Communication with WCS (Arduino)
  * 
  * Sends valve control commands and receives status updates
  * Runs in its own thread
+ * 
+ * The link starts with JSON lines at baudRate. With negotiation enabled the
+ * heartbeat is a hello asking for the binary protocol at fastBaudRate; a WCS
+ * that supports it answers {"hello":1,"baud":N} and both sides switch to
+ * COBS/CRC frames (LinkFrame) at N. Older WCS firmware ignores the hello and
+ * the link stays on JSON. Without frames for LINK_TIMEOUT_MS the link falls
+ * back to JSON and negotiates again.
+ *
+ * Valve and mode commands carry an id and are tracked until the WCS acks
+ * them (CommandTracker): unanswered ones are resent, and the round-trip
+ * times end up in SystemState.
+ *
+ * With local control enabled, every live level sample and (periodically)
+ * the L1/L2/T1 policy are forwarded, and the WCS runs the threshold policy
+ * itself (WCS mode LOCAL, seen here as AUTOMATIC).
  */
 public class SerialService implements Runnable {
 
+    private static final long HEARTBEAT_INTERVAL_MS = 2000; // Send heartbeat every 2 seconds
+    private static final long LINK_TIMEOUT_MS = 5000;       // Same as CUS_TIMEOUT_MS on the WCS
+    private static final int MAX_MESSAGE_SIZE = 256;
+    private static final long POLICY_REFRESH_MS = 10000; // Policy resent for a restarted WCS
+    private static final int LEVEL_UNITS_PER_CM = 100; // 0.1 mm, as on the TMS and WCS
+
     private final String portName;
     private final int baudRate;
     private final SystemState systemState;
+    private final boolean negotiate;
+    private final int fastBaudRate;
 
     private SerialPort serialPort;
-    private BufferedReader reader;
+    private InputStream input;
+    private OutputStream output;
     private PrintWriter writer;
     private final Gson gson;
+    private final CommandTracker commands;
+
+    // Local control policy forwarded to the WCS, null when disabled
+    private volatile int[] localPolicy; // L1, L2 (0.1 mm), T1 (ms)
+    private long lastPolicySent = 0;
 
     private volatile boolean running = false;
 
+    // Link state (switched by the serial thread, read by the senders)
+    private volatile boolean binaryLink = false;
+    private final ByteArrayOutputStream rxBuffer = new ByteArrayOutputStream(MAX_MESSAGE_SIZE);
+    private long lastFrameTime;
+    private int txSeq = 0;
+    private int rxErrors = 0;
+    private String lastStatusMode = null;
+    private int lastStatusValve = -1;
+    private int lastStatusSeq = -1;
+    private int lostStatus = 0;
+
+    // Valve motion (the WCS ramps towards the commanded position)
+    private int lastValveCommand = -1;
+    private long valveCommandTime;
+    private boolean valveMoving = false;
+
     public SerialService(String portName, int baudRate, SystemState systemState) {
+        this(portName, baudRate, systemState, false, baudRate);
+    }
+
+    public SerialService(String portName, int baudRate, SystemState systemState,
+            boolean negotiate, int fastBaudRate) {
         this.portName = portName;
         this.baudRate = baudRate;
         this.systemState = systemState;
+        this.negotiate = negotiate;
+        this.fastBaudRate = fastBaudRate;
         this.gson = new Gson();
+        this.commands = new CommandTracker(systemState);
     }
 
     @Override
@@ -51,15 +106,16 @@ public class SerialService implements Runnable {
 
         try {
             long lastHeartbeat = System.currentTimeMillis();
-            final long HEARTBEAT_INTERVAL_MS = 2000; // Send heartbeat every 2 seconds
+            byte[] chunk = new byte[64];
 
-            // Main loop - read incoming messages from WCS and send heartbeat
             // Main loop - read incoming messages from WCS and send heartbeat
             while (running) {
                 try {
-                    String line = reader.readLine(); // Blocking read
-                    if (line != null && !line.trim().isEmpty()) {
-                        handleIncomingMessage(line.trim());
+                    int count = input.read(chunk); // Blocks up to the read timeout
+                    for (int i = 0; i < count; i++) {
+                        if (handleIncomingByte(chunk[i])) {
+                            break; // Link switched: the rest was sent at the other baud rate
+                        }
                     }
                 } catch (Exception e) {
                     // Timeout is expected if no data, just continue
@@ -71,6 +127,17 @@ public class SerialService implements Runnable {
                     sendHeartbeat();
                     lastHeartbeat = now;
                 }
+
+                if (binaryLink && now - lastFrameTime > LINK_TIMEOUT_MS) {
+                    fallBackToJson();
+                }
+
+                retryCommands();
+
+                if (localPolicy != null && now - lastPolicySent >= POLICY_REFRESH_MS) {
+                    sendLocalPolicy();
+                    lastPolicySent = now;
+                }
             }
         } catch (Exception e) {
             System.err.println("[Serial] Error: " + e.getMessage());
@@ -95,9 +162,10 @@ public class SerialService implements Runnable {
             if (serialPort.openPort()) {
                 System.out.println("[Serial] Port opened: " + portName + " @ " + baudRate + " baud");
 
-                // Initialize reader and writer
-                reader = new BufferedReader(new InputStreamReader(serialPort.getInputStream()));
-                writer = new PrintWriter(serialPort.getOutputStream(), true);
+                // Initialize streams
+                input = serialPort.getInputStream();
+                output = serialPort.getOutputStream();
+                writer = new PrintWriter(output, true);
 
                 return true;
             } else {
@@ -110,37 +178,244 @@ public class SerialService implements Runnable {
         }
     }
 
+    /**
+     * Assemble JSON lines ('\n') or binary frames (0x00) byte by byte
+     * 
+     * @return true if the message switched the link protocol
+     */
+    private boolean handleIncomingByte(byte b) {
+        boolean binary = binaryLink;
+        byte delimiter = binary ? (byte) 0 : (byte) '\n';
+
+        if (b != delimiter) {
+            if (rxBuffer.size() >= MAX_MESSAGE_SIZE) {
+                rxBuffer.reset(); // Overlong: resynchronise on the next delimiter
+                rxErrors++;
+            }
+            rxBuffer.write(b);
+            return false;
+        }
+
+        byte[] message = rxBuffer.toByteArray();
+        rxBuffer.reset();
+        if (binary) {
+            if (message.length > 0) {
+                handleIncomingFrame(message);
+            }
+        } else {
+            String line = new String(message, StandardCharsets.US_ASCII).trim();
+            if (!line.isEmpty()) {
+                handleIncomingMessage(line);
+            }
+        }
+        return binary != binaryLink;
+    }
+
+    /**
+     * Handle a binary frame from WCS
+     */
+    private void handleIncomingFrame(byte[] encoded) {
+        LinkFrame frame;
+        try {
+            frame = LinkFrame.decode(encoded);
+        } catch (IllegalArgumentException e) {
+            rxErrors++;
+            System.err.println("[Serial] Bad frame (" + rxErrors + " errors): " + e.getMessage());
+            return;
+        }
+        lastFrameTime = System.currentTimeMillis();
+
+        if (frame.opcode == LinkFrame.OP_STATUS && frame.payload.length >= 2) {
+            int valve = Byte.toUnsignedInt(frame.payload[1]);
+            int command = frame.payload.length >= 5 ? Byte.toUnsignedInt(frame.payload[4]) : -1;
+            int seq = frame.payload.length >= 7 ? unsigned16(frame.payload, 5) : -1;
+            applyStatus(modeName(Byte.toUnsignedInt(frame.payload[0])), valve, command, seq);
+        } else if (frame.opcode == LinkFrame.OP_ACK && frame.payload.length >= 6) {
+            handleCommandReply(unsigned16(frame.payload, 0), Byte.toUnsignedInt(frame.payload[2]),
+                    Byte.toUnsignedInt(frame.payload[3]), unsigned16(frame.payload, 4));
+        } else if (frame.opcode == LinkFrame.OP_SCHED && frame.payload.length >= 8) {
+            int task = Byte.toUnsignedInt(frame.payload[0]);
+            String name = task < LinkFrame.WCS_TASK_NAMES.length
+                    ? LinkFrame.WCS_TASK_NAMES[task] : "task" + task;
+            systemState.setWcsTaskTiming(name, unsigned16(frame.payload, 1),
+                    Byte.toUnsignedInt(frame.payload[3]));
+            systemState.setWcsLoopTiming(unsigned16(frame.payload, 4), unsigned16(frame.payload, 6));
+        }
+    }
+
+    /**
+     * Apply a WCS status (either protocol)
+     * The WCS only sends it on a change or as a keepalive; while the valve
+     * moves that is every status, so only mode changes, new commands and the
+     * settled position are logged
+     *
+     * @param command Commanded valve position, -1 if not reported
+     * @param seq     Status sequence number, -1 if not reported
+     */
+    private void applyStatus(String mode, int valve, int command, int seq) {
+        if (seq >= 0) {
+            checkStatusSeq(seq);
+        }
+        // Without cmd (older WCS firmware) there is no motion tracking: log each valve change
+        if (!mode.equals(lastStatusMode) || (command < 0 && valve != lastStatusValve)) {
+            System.out.println("[Serial] WCS Mode: " + mode + ", Valve: " + valve + "%");
+            lastStatusMode = mode;
+        }
+        lastStatusValve = valve;
+        applyWcsMode(mode);  // SystemState only logs actual changes
+        systemState.setCurrentValveOpening(valve);
+        if (command >= 0) {
+            updateValveMotion(valve, command);
+        }
+    }
+
+    /**
+     * Count status messages lost between two sequence numbers (16 bit, wrapping)
+     */
+    private void checkStatusSeq(int seq) {
+        if (lastStatusSeq >= 0) {
+            int gap = (seq - lastStatusSeq - 1) & 0xFFFF;
+            if (gap >= 0x8000) {
+                System.out.println("[Serial] WCS status sequence restarted at " + seq);
+            } else if (gap > 0) {
+                lostStatus += gap;
+                System.err.println("[Serial] Lost " + gap + " WCS status message(s), " + lostStatus + " in total");
+            }
+        }
+        lastStatusSeq = seq;
+    }
+
+    private static int unsigned16(byte[] data, int offset) {
+        return Byte.toUnsignedInt(data[offset]) | (Byte.toUnsignedInt(data[offset + 1]) << 8);
+    }
+
+    /**
+     * Track the commanded position reported by the WCS and measure how long
+     * the valve takes to reach it
+     */
+    private void updateValveMotion(int valve, int command) {
+        long now = System.currentTimeMillis();
+        if (command != lastValveCommand) {
+            lastValveCommand = command;
+            valveCommandTime = now;
+            valveMoving = true;
+            systemState.setValveCommand(command);
+            if (valve != command) {
+                System.out.println("[Serial] Valve moving from " + valve + "% to " + command + "%");
+            }
+        }
+        if (valveMoving && valve == command) {
+            long settleMs = now - valveCommandTime;
+            valveMoving = false;
+            systemState.setValveSettleMs(settleMs);
+            System.out.println("[Serial] Valve settled at " + valve + "% in " + settleMs + " ms");
+        }
+    }
+
+    /**
+     * WCS mode code of the binary status (SystemMode order on the WCS)
+     */
+    private static String modeName(int mode) {
+        switch (mode) {
+            case 1:
+                return "AUTOMATIC";
+            case 2:
+                return "MANUAL";
+            case 3:
+                return "LOCAL";
+            default:
+                return "UNCONNECTED";
+        }
+    }
+
+    private void applyWcsMode(String mode) {
+        systemState.setWcsLocalControl(mode.equals("LOCAL"));
+        if (mode.equals("AUTOMATIC") || mode.equals("LOCAL")) {
+            systemState.setCurrentMode(SystemState.Mode.AUTOMATIC);
+        } else if (mode.equals("MANUAL")) {
+            systemState.setCurrentMode(SystemState.Mode.MANUAL);
+        } else if (mode.equals("UNCONNECTED")) {
+            systemState.setCurrentMode(SystemState.Mode.UNCONNECTED);
+        }
+    }
+
+    /**
+     * The WCS accepted the hello: follow it to the binary protocol
+     */
+    private synchronized void switchToBinary(int linkBaudRate) {
+        writer.flush();
+        serialPort.setBaudRate(linkBaudRate);
+        rxBuffer.reset();
+        binaryLink = true;
+        lastFrameTime = System.currentTimeMillis();
+        lastStatusMode = null;
+        lastStatusValve = -1;
+        lastPolicySent = 0; // Resend the policy on the new link
+        System.out.println("[Serial] Binary protocol @ " + linkBaudRate + " baud");
+        sendFrame(LinkFrame.OP_PING, new byte[0]);
+    }
+
+    /**
+     * No frames from the WCS: it has returned to JSON at the base rate
+     */
+    private synchronized void fallBackToJson() {
+        serialPort.setBaudRate(baudRate);
+        rxBuffer.reset();
+        binaryLink = false;
+        lastPolicySent = 0;
+        systemState.setWcsLocalControl(false); // Until a status says otherwise
+        System.out.println("[Serial] Link lost, back to JSON @ " + baudRate + " baud");
+    }
+
+    /**
+     * Send one binary frame (caller holds the lock)
+     */
+    private void sendFrame(int opcode, byte[] payload) {
+        try {
+            output.write(new LinkFrame(opcode, txSeq, payload).encode());
+            output.flush();
+            txSeq = (txSeq + 1) & 0xFF;
+        } catch (Exception e) {
+            System.err.println("[Serial] Error sending frame: " + e.getMessage());
+        }
+    }
+
     /**
      * Handle incoming message from WCS
      */
     private void handleIncomingMessage(String message) {
         try {
-            System.out.println("[Serial] Received: " + message);
-
             // Parse JSON message
             JsonObject json = gson.fromJson(message, JsonObject.class);
 
-            if (json.has("mode")) {
-                String mode = json.get("mode").getAsString();
-                System.out.println("[Serial] WCS Mode: " + mode);
-                if (mode.equals("AUTOMATIC")) {
-                    systemState.setCurrentMode(SystemState.Mode.AUTOMATIC);
-                } else if (mode.equals("MANUAL")) {
-                    systemState.setCurrentMode(SystemState.Mode.MANUAL);
-                } else if (mode.equals("UNCONNECTED")) {
-                    systemState.setCurrentMode(SystemState.Mode.UNCONNECTED);
-                }
+            if (json.has("hello") && json.get("hello").getAsInt() == LinkFrame.PROTOCOL_VERSION) {
+                switchToBinary(json.get("baud").getAsInt());
+                return;
+            }
+
+            if (json.has("ack") || json.has("nack")) {
+                boolean ack = json.has("ack");
+                int result = ack ? CommandTracker.RESULT_OK : resultCode(json.get("reason").getAsString());
+                handleCommandReply(json.get(ack ? "ack" : "nack").getAsInt(), result,
+                        json.get("value").getAsInt(), json.get("us").getAsInt());
+                return;
             }
 
-            if (json.has("valve")) {
-                int valve = json.get("valve").getAsInt();
-                System.out.println("[Serial] WCS Valve: " + valve + "%");
-                // Update system state with actual valve position
-                systemState.setCurrentValveOpening(valve);
+            if (json.has("sched")) {
+                systemState.setWcsTaskTiming(json.get("sched").getAsString(),
+                        json.get("max").getAsInt(), json.get("ovr").getAsInt());
+                systemState.setWcsLoopTiming(json.get("loop").getAsInt(), json.get("lovr").getAsInt());
+                return;
+            }
+
+            if (json.has("mode") && json.has("valve")) {
+                applyStatus(json.get("mode").getAsString(), json.get("valve").getAsInt(),
+                        json.has("cmd") ? json.get("cmd").getAsInt() : -1,
+                        json.has("seq") ? json.get("seq").getAsInt() : -1);
             }
 
         } catch (Exception e) {
-            System.err.println("[Serial] Error parsing message: " + e.getMessage());
+            System.err.println("[Serial] Error parsing message '" + message + "': " + e.getMessage());
         }
     }
 
@@ -154,18 +429,10 @@ public class SerialService implements Runnable {
             return;
         }
 
-        try {
-            JsonObject command = new JsonObject();
-            command.addProperty("cmd", "set_valve");
-            command.addProperty("value", percentage);
-
-            String json = gson.toJson(command);
-            writer.println(json);
-            writer.flush();
-
-            System.out.println("[Serial] Sent valve command: " + percentage + "%");
-        } catch (Exception e) {
-            System.err.println("[Serial] Error sending valve command: " + e.getMessage());
+        CommandTracker.PendingCommand command = commands.create("set_valve", percentage);
+        if (command != null) {
+            transmitCommand(command);
+            System.out.println("[Serial] Sent valve command: " + percentage + "% (id " + command.id + ")");
         }
     }
 
@@ -179,23 +446,147 @@ public class SerialService implements Runnable {
             return;
         }
 
-        try {
-            JsonObject command = new JsonObject();
-            command.addProperty("cmd", "set_mode");
-            command.addProperty("value", mode);
+        int code = mode.equals("AUTOMATIC") ? 1 : mode.equals("MANUAL") ? 2 : 0;
+        CommandTracker.PendingCommand command = commands.create("set_mode", code);
+        if (command != null) {
+            transmitCommand(command);
+            System.out.println("[Serial] Sent mode command: " + mode + " (id " + command.id + ")");
+        }
+    }
 
-            String json = gson.toJson(command);
-            writer.println(json);
-            writer.flush();
+    /**
+     * Send (or resend) a tracked command on the current link (caller holds the lock)
+     */
+    private void transmitCommand(CommandTracker.PendingCommand command) {
+        boolean valve = command.type.equals("set_valve");
+
+        if (binaryLink) {
+            sendFrame(valve ? LinkFrame.OP_SET_VALVE : LinkFrame.OP_SET_MODE,
+                    new byte[] { (byte) command.value, (byte) command.id, (byte) (command.id >> 8) });
+        } else {
+            try {
+                JsonObject json = new JsonObject();
+                json.addProperty("cmd", command.type);
+                if (valve) {
+                    json.addProperty("value", command.value);
+                } else {
+                    json.addProperty("value", modeName(command.value));
+                }
+                json.addProperty("id", command.id);
 
-            System.out.println("[Serial] Sent mode command: " + mode);
-        } catch (Exception e) {
-            System.err.println("[Serial] Error sending mode command: " + e.getMessage());
+                writer.println(gson.toJson(json));
+                writer.flush();
+            } catch (Exception e) {
+                System.err.println("[Serial] Error sending " + command.type + ": " + e.getMessage());
+            }
         }
+        commands.markSent(command);
+    }
+
+    /**
+     * Resend the commands whose answer is overdue
+     */
+    private synchronized void retryCommands() {
+        for (CommandTracker.PendingCommand command : commands.due()) {
+            System.out.println("[Serial] Retrying " + command.type + " id " + command.id
+                    + " (attempt " + (command.getAttempts() + 1) + ")");
+            transmitCommand(command);
+        }
+    }
+
+    /**
+     * Ack or nack of a command from WCS
+     */
+    private void handleCommandReply(int id, int result, int value, int wcsUs) {
+        CommandTracker.PendingCommand command = commands.complete(id, result, wcsUs);
+        if (command == null) {
+            return; // Superseded, or a duplicate answer to a retry
+        }
+
+        if (result == CommandTracker.RESULT_OK) {
+            if (command.type.equals("set_valve")) {
+                systemState.setValveCommand(value);
+            }
+        } else if (commands.isInFlight(command)) {
+            System.out.println("[Serial] " + command.type + " id " + id + " not applied yet (WCS connecting), retrying");
+        } else {
+            System.err.println("[Serial] " + command.type + " id " + id + " rejected by WCS (result " + result + ")");
+        }
+    }
+
+    /**
+     * Result code of a JSON nack reason (CMD_* order on the WCS)
+     */
+    private static int resultCode(String reason) {
+        switch (reason) {
+            case "unconnected":
+                return CommandTracker.RESULT_UNCONNECTED;
+            case "bad_value":
+                return CommandTracker.RESULT_BAD_VALUE;
+            default:
+                return CommandTracker.RESULT_UNKNOWN;
+        }
+    }
+
+    /**
+     * Enable local control on the WCS with the CUS policy parameters
+     */
+    public void setLocalPolicy(int l1Cm, int l2Cm, long t1Ms) {
+        this.localPolicy = new int[] { l1Cm * LEVEL_UNITS_PER_CM, l2Cm * LEVEL_UNITS_PER_CM, (int) t1Ms };
+    }
+
+    /**
+     * Send the local control policy to the WCS (not tracked: resent periodically)
+     */
+    private synchronized void sendLocalPolicy() {
+        int[] policy = localPolicy;
+        if (writer == null || policy == null) {
+            return;
+        }
+
+        if (binaryLink) {
+            sendFrame(LinkFrame.OP_SET_POLICY, new byte[] {
+                    (byte) policy[0], (byte) (policy[0] >> 8),
+                    (byte) policy[1], (byte) (policy[1] >> 8),
+                    (byte) policy[2], (byte) (policy[2] >> 8), (byte) (policy[2] >> 16), (byte) (policy[2] >> 24) });
+            return;
+        }
+
+        JsonObject command = new JsonObject();
+        command.addProperty("cmd", "policy");
+        command.addProperty("l1", policy[0]);
+        command.addProperty("l2", policy[1]);
+        command.addProperty("t1", policy[2]);
+        writer.println(gson.toJson(command));
+        writer.flush();
+    }
+
+    /**
+     * Forward a live level sample to the WCS for local control
+     * Not tracked: the next sample replaces a lost one
+     * This method is thread-safe and can be called from other threads
+     */
+    public synchronized void sendLevelSample(float levelCm) {
+        if (writer == null || localPolicy == null) {
+            return;
+        }
+
+        int level = Math.max(0, Math.min(0xFFFF, Math.round(levelCm * LEVEL_UNITS_PER_CM)));
+        if (binaryLink) {
+            sendFrame(LinkFrame.OP_LEVEL, new byte[] { (byte) level, (byte) (level >> 8) });
+            return;
+        }
+
+        JsonObject command = new JsonObject();
+        command.addProperty("cmd", "level");
+        command.addProperty("value", level);
+        writer.println(gson.toJson(command));
+        writer.flush();
     }
 
     /**
      * Send heartbeat ping to WCS to keep connection alive
+     * On JSON with negotiation enabled the heartbeat is a hello
      * This method is thread-safe and can be called from other threads
      */
     public synchronized void sendHeartbeat() {
@@ -203,9 +594,20 @@ public class SerialService implements Runnable {
             return; // Silently fail if port not open
         }
 
+        if (binaryLink) {
+            sendFrame(LinkFrame.OP_PING, new byte[0]);
+            return;
+        }
+
         try {
             JsonObject command = new JsonObject();
-            command.addProperty("cmd", "ping");
+            if (negotiate) {
+                command.addProperty("cmd", "hello");
+                command.addProperty("proto", LinkFrame.PROTOCOL_VERSION);
+                command.addProperty("baud", fastBaudRate);
+            } else {
+                command.addProperty("cmd", "ping");
+            }
 
             String json = gson.toJson(command);
             writer.println(json);
@@ -1,7 +1,9 @@
 package it.unibo.esiot.cus.model;
 
 import java.util.ArrayList;
+import java.util.LinkedHashMap;
 import java.util.List;
+import java.util.Map;
 import java.util.concurrent.locks.ReadWriteLock;
 import java.util.concurrent.locks.ReentrantReadWriteLock;
 
@@ -28,8 +30,16 @@ public class SystemState {
     // Current system state
     private Mode currentMode;
     private float currentWaterLevel; // in cm
-    private int currentValveOpening; // 0-100%
+    private int currentValveOpening; // 0-100%, actual position reported by the WCS
+    private int valveCommand; // 0-100%, position the WCS is moving towards
+    private boolean wcsLocalControl; // WCS reports LOCAL: it runs the threshold policy itself
+    private long valveSettleMs; // time the last command took to complete, -1 if unknown
+    private final Map<String, TaskTiming> wcsTaskTimings; // WCS scheduler, per task
+    private int wcsLoopMaxUs; // longest WCS loop pass = input latency bound
+    private int wcsLoopOverruns;
+    private final Map<String, CommandLatency> commandLatency; // per WCS command type
     private long lastTMSMessageTime; // timestamp of last TMS message
+    private String edgeAlarm; // alarm state reported by the TMS edge engine
 
     // Historical data
     private final List<WaterLevelReading> levelHistory;
@@ -48,6 +58,50 @@ public class SystemState {
         }
     }
 
+    /**
+     * Execution time of one WCS scheduler task, as last reported
+     */
+    public static class TaskTiming {
+        public final int maxUs;
+        public final int overruns;
+
+        public TaskTiming(int maxUs, int overruns) {
+            this.maxUs = maxUs;
+            this.overruns = overruns;
+        }
+    }
+
+    /**
+     * Outcome and round-trip times of the commands of one type sent to the WCS
+     * RTTs run from the first send to the ack (retries included), in ms
+     */
+    public static class CommandLatency {
+        public final int sent;
+        public final int acked;
+        public final int nacked;
+        public final int failed;
+        public final int retries;
+        public final double p50Ms;
+        public final double p90Ms;
+        public final double p99Ms;
+        public final double maxMs;
+        public final int wcsMaxUs; // longest processing time reported by the WCS
+
+        public CommandLatency(int sent, int acked, int nacked, int failed, int retries,
+                double p50Ms, double p90Ms, double p99Ms, double maxMs, int wcsMaxUs) {
+            this.sent = sent;
+            this.acked = acked;
+            this.nacked = nacked;
+            this.failed = failed;
+            this.retries = retries;
+            this.p50Ms = p50Ms;
+            this.p90Ms = p90Ms;
+            this.p99Ms = p99Ms;
+            this.maxMs = maxMs;
+            this.wcsMaxUs = wcsMaxUs;
+        }
+    }
+
     /**
      * Constructor
      */
@@ -61,7 +115,14 @@ public class SystemState {
         this.currentMode = Mode.UNCONNECTED;
         this.currentWaterLevel = 0.0f;
         this.currentValveOpening = 0;
+        this.valveCommand = 0;
+        this.valveSettleMs = -1;
+        this.wcsTaskTimings = new LinkedHashMap<>();
+        this.wcsLoopMaxUs = 0;
+        this.wcsLoopOverruns = 0;
+        this.commandLatency = new LinkedHashMap<>();
         this.lastTMSMessageTime = 0;
+        this.edgeAlarm = "UNKNOWN";
     }
 
     // ==================== GETTERS (Thread-safe) ====================
@@ -75,6 +136,19 @@ public class SystemState {
         }
     }
 
+    /**
+     * Whether the WCS is running the threshold policy itself (mode LOCAL,
+     * reported to clients as AUTOMATIC)
+     */
+    public boolean isWcsLocalControl() {
+        lock.readLock().lock();
+        try {
+            return wcsLocalControl;
+        } finally {
+            lock.readLock().unlock();
+        }
+    }
+
     public float getCurrentWaterLevel() {
         lock.readLock().lock();
         try {
@@ -93,6 +167,60 @@ public class SystemState {
         }
     }
 
+    public int getValveCommand() {
+        lock.readLock().lock();
+        try {
+            return valveCommand;
+        } finally {
+            lock.readLock().unlock();
+        }
+    }
+
+    public long getValveSettleMs() {
+        lock.readLock().lock();
+        try {
+            return valveSettleMs;
+        } finally {
+            lock.readLock().unlock();
+        }
+    }
+
+    public Map<String, TaskTiming> getWcsTaskTimings() {
+        lock.readLock().lock();
+        try {
+            return new LinkedHashMap<>(wcsTaskTimings); // Return a copy
+        } finally {
+            lock.readLock().unlock();
+        }
+    }
+
+    public int getWcsLoopMaxUs() {
+        lock.readLock().lock();
+        try {
+            return wcsLoopMaxUs;
+        } finally {
+            lock.readLock().unlock();
+        }
+    }
+
+    public int getWcsLoopOverruns() {
+        lock.readLock().lock();
+        try {
+            return wcsLoopOverruns;
+        } finally {
+            lock.readLock().unlock();
+        }
+    }
+
+    public Map<String, CommandLatency> getCommandLatency() {
+        lock.readLock().lock();
+        try {
+            return new LinkedHashMap<>(commandLatency); // Return a copy
+        } finally {
+            lock.readLock().unlock();
+        }
+    }
+
     public long getLastTMSMessageTime() {
         lock.readLock().lock();
         try {
@@ -102,6 +230,15 @@ public class SystemState {
         }
     }
 
+    public String getEdgeAlarm() {
+        lock.readLock().lock();
+        try {
+            return edgeAlarm;
+        } finally {
+            lock.readLock().unlock();
+        }
+    }
+
     public List<WaterLevelReading> getLevelHistory() {
         lock.readLock().lock();
         try {
@@ -116,8 +253,10 @@ public class SystemState {
     public void setCurrentMode(Mode mode) {
         lock.writeLock().lock();
         try {
+            if (this.currentMode != mode) {
+                System.out.println("[SystemState] Mode changed to: " + mode);
+            }
             this.currentMode = mode;
-            System.out.println("[SystemState] Mode changed to: " + mode);
         } finally {
             lock.writeLock().unlock();
         }
@@ -143,11 +282,97 @@ public class SystemState {
         }
     }
 
+    /**
+     * Merge readings taken while the TMS was offline into the history
+     * They are older than the live value, so the current level is untouched
+     */
+    public void addBackfilledReadings(List<WaterLevelReading> readings) {
+        lock.writeLock().lock();
+        try {
+            levelHistory.addAll(readings);
+            levelHistory.sort((a, b) -> Long.compare(a.timestamp, b.timestamp));
+
+            // Remove oldest if exceeds max size
+            while (levelHistory.size() > maxHistorySize) {
+                levelHistory.remove(0);
+            }
+        } finally {
+            lock.writeLock().unlock();
+        }
+    }
+
+    public void setEdgeAlarm(String state) {
+        lock.writeLock().lock();
+        try {
+            this.edgeAlarm = state;
+        } finally {
+            lock.writeLock().unlock();
+        }
+    }
+
+    public void setValveCommand(int command) {
+        lock.writeLock().lock();
+        try {
+            this.valveCommand = Math.max(0, Math.min(100, command));
+        } finally {
+            lock.writeLock().unlock();
+        }
+    }
+
+    public void setValveSettleMs(long settleMs) {
+        lock.writeLock().lock();
+        try {
+            this.valveSettleMs = settleMs;
+        } finally {
+            lock.writeLock().unlock();
+        }
+    }
+
+    public void setWcsTaskTiming(String task, int maxUs, int overruns) {
+        lock.writeLock().lock();
+        try {
+            wcsTaskTimings.put(task, new TaskTiming(maxUs, overruns));
+        } finally {
+            lock.writeLock().unlock();
+        }
+    }
+
+    public void setWcsLoopTiming(int maxUs, int overruns) {
+        lock.writeLock().lock();
+        try {
+            this.wcsLoopMaxUs = maxUs;
+            this.wcsLoopOverruns = overruns;
+        } finally {
+            lock.writeLock().unlock();
+        }
+    }
+
+    public void setCommandLatency(String command, CommandLatency latency) {
+        lock.writeLock().lock();
+        try {
+            commandLatency.put(command, latency);
+        } finally {
+            lock.writeLock().unlock();
+        }
+    }
+
+    public void setWcsLocalControl(boolean local) {
+        lock.writeLock().lock();
+        try {
+            if (this.wcsLocalControl != local) {
+                System.out.println("[SystemState] WCS local control " + (local ? "active" : "inactive"));
+            }
+            this.wcsLocalControl = local;
+        } finally {
+            lock.writeLock().unlock();
+        }
+    }
+
     public void setCurrentValveOpening(int opening) {
         lock.writeLock().lock();
         try {
+            // Not logged: updated with every WCS status while the valve moves
             this.currentValveOpening = Math.max(0, Math.min(100, opening));
-            System.out.println("[SystemState] Valve opening updated: " + this.currentValveOpening + "%");
         } finally {
             lock.writeLock().unlock();
         }
@@ -28,6 +28,10 @@ public class TankMonitor implements Runnable {
 
     private volatile boolean running = false;
 
+    // Lets an edge alert run the policy before the next poll
+    private final Object wakeLock = new Object();
+    private boolean updateRequested = false;
+
     private static final long UPDATE_INTERVAL_MS = 500; // Check every 500ms
 
     public TankMonitor(SystemState systemState, SerialService serialService,
@@ -54,7 +58,12 @@ public class TankMonitor implements Runnable {
         try {
             while (running) {
                 updateControlLogic();
-                Thread.sleep(UPDATE_INTERVAL_MS);
+                synchronized (wakeLock) {
+                    if (!updateRequested) {
+                        wakeLock.wait(UPDATE_INTERVAL_MS);
+                    }
+                    updateRequested = false;
+                }
             }
         } catch (InterruptedException e) {
             System.out.println("[TankMonitor] Thread interrupted");
@@ -96,12 +105,19 @@ public class TankMonitor implements Runnable {
         // Apply control policy
         int targetValveOpening = calculateValveOpening(currentLevel);
 
-        // Send command to WCS if valve opening needs to change
-        if (targetValveOpening != systemState.getCurrentValveOpening()) {
+        // The WCS in LOCAL runs this policy on every forwarded sample; a command
+        // from here would only suspend it (the timers above keep running for
+        // when the WCS hands control back)
+        if (systemState.isWcsLocalControl()) {
+            return;
+        }
+
+        // Send command to WCS if the commanded opening needs to change
+        // (the WCS acks it and reports the actual opening while the valve moves)
+        if (targetValveOpening != systemState.getValveCommand()) {
             System.out.println(
                     "[TankMonitor] Setting valve to " + targetValveOpening + "% (level: " + currentLevel + " cm)");
             serialService.sendValveCommand(targetValveOpening);
-            systemState.setCurrentValveOpening(targetValveOpening);
         }
     }
 
@@ -141,8 +157,8 @@ public class TankMonitor implements Runnable {
                 // Been above L1 for T1 time - open at 50%
                 return 50;
             } else {
-                // Still within T1 period - keep valve as is
-                return systemState.getCurrentValveOpening();
+                // Still within T1 period - keep the commanded opening
+                return systemState.getValveCommand();
             }
         }
 
@@ -159,6 +175,17 @@ public class TankMonitor implements Runnable {
         }
     }
 
+    /**
+     * Run the control logic now instead of at the next poll
+     * Called by the MQTT service when the TMS reports an alarm state change
+     */
+    public void requestUpdate() {
+        synchronized (wakeLock) {
+            updateRequested = true;
+            wakeLock.notifyAll();
+        }
+    }
+
     /**
      * Stop the tank monitor
      */
@@ -0,0 +1,443 @@
+/**
+ * Native HAL - Arduino Core
+ * Host implementation of the Arduino API used by TMS and WCS
+ * (clock, GPIO, pulseIn, String, Print and Serial) on top of the simulated board
+ */
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "SimBoard.h"
+#include "SimRtos.h"
+
+// ==================== CONSTANTS ====================
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+
+#define DEC 10
+#define HEX 16
+
+// Analog pins use the Uno numbering
+const uint8_t A0 = 14;
+const uint8_t A1 = 15;
+const uint8_t A2 = 16;
+const uint8_t A3 = 17;
+
+// ==================== TIME ====================
+
+inline unsigned long micros() {
+    return (unsigned long)sim::uptimeUs();
+}
+
+inline unsigned long millis() {
+    return (unsigned long)(sim::uptimeUs() / 1000);
+}
+
+inline void delay(unsigned long ms) {
+    sim::board().clock.sleepUs((uint64_t)ms * 1000);
+}
+
+inline void delayMicroseconds(unsigned int us) {
+    sim::board().clock.sleepUs(us);
+}
+
+inline void yield() {
+    std::this_thread::yield();
+}
+
+// Sketch code runs on one host thread: nothing to mask
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// ==================== CHIP ====================
+
+/**
+ * Subset of the ESP32 Arduino ESP object
+ * The cycle counter is derived from the board clock at SIM_CPU_MHZ
+ */
+namespace sim {
+
+/**
+ * Cycle count seen by a simulated ISR (0 = read the clock)
+ * Lets edge handlers observe exact edge times despite host scheduling jitter
+ */
+inline uint32_t& isrCycleStamp() {
+    thread_local uint32_t stamp = 0;
+    return stamp;
+}
+
+} // namespace sim
+
+class EspClass {
+public:
+    uint32_t getCycleCount() {
+        uint32_t stamp = sim::isrCycleStamp();
+        return stamp ? stamp : (uint32_t)(sim::board().clock.micros() * sim::SIM_CPU_MHZ);
+    }
+    uint32_t getCpuFreqMHz() { return sim::SIM_CPU_MHZ; }
+    uint32_t getFreeHeap() { return sim::SIM_HEAP_BYTES; }
+    uint32_t getMinFreeHeap() { return sim::SIM_HEAP_BYTES; }
+};
+
+inline EspClass ESP;
+
+// ==================== MATH ====================
+
+template <typename T, typename L, typename H>
+inline T constrain(T value, L low, H high) {
+    return value < (T)low ? (T)low : (value > (T)high ? (T)high : value);
+}
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+inline long random(long howBig) {
+    return howBig <= 0 ? 0 : rand() % howBig;
+}
+
+inline long random(long howSmall, long howBig) {
+    return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall);
+}
+
+inline void randomSeed(unsigned long seed) {
+    srand((unsigned int)seed);
+}
+
+// ==================== GPIO ====================
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+    sim::board().gpio.mode[pin] = mode;
+    if (mode == INPUT_PULLUP) {
+        sim::board().gpio.level[pin] = HIGH;
+    }
+}
+
+inline int digitalPinToInterrupt(uint8_t pin) {
+    return pin;
+}
+
+inline void attachInterrupt(uint8_t pin, void (*handler)(), int mode) {
+    (void)mode;
+    sim::board().gpio.isr[pin] = handler;
+}
+
+inline void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode) {
+    (void)mode;
+    sim::board().gpio.isrArg[pin] = arg;
+    sim::board().gpio.isrWithArg[pin] = handler;
+}
+
+inline void detachInterrupt(uint8_t pin) {
+    sim::board().gpio.isr[pin] = nullptr;
+    sim::board().gpio.isrWithArg[pin] = nullptr;
+}
+
+namespace sim {
+
+/**
+ * Sonar that a trigger pulse on this pin fires
+ */
+inline Sonar& sonarForTrigger(int pin) {
+    Board& b = board();
+    for (Sonar& extra : b.extraSonars) {
+        if (extra.trigPin == pin) {
+            return extra;
+        }
+    }
+    return b.sonar;
+}
+
+/**
+ * Drive the echo line of a simulated sonar through its interrupt handler
+ * Rising edge fires right after the trigger, falling edge one echo time later
+ */
+inline void deliverSonarEcho(Sonar& sonar) {
+    Board& b = board();
+    for (int pin = 0; pin < SIM_PIN_COUNT; pin++) {
+        if (!b.gpio.hasIsr(pin) || (sonar.echoPin >= 0 && sonar.echoPin != pin)) {
+            continue;
+        }
+        sonar.armed = false;
+        unsigned long echo = sonar.echoUs();
+        if (echo == 0) {
+            return;  // No echo: the line never rises, the reader times out
+        }
+        uint32_t riseCycles = (uint32_t)(b.clock.micros() * SIM_CPU_MHZ) | 1;
+        uint32_t fallCycles = riseCycles + (uint32_t)(echo * SIM_CPU_MHZ);
+        
+        b.gpio.level[pin] = HIGH;
+        isrCycleStamp() = riseCycles;
+        b.gpio.fireIsr(pin);
+        isrCycleStamp() = 0;
+        
+        if (b.clock.isVirtualTime()) {
+            // Single-threaded simulation: the echo window passes synchronously
+            b.clock.sleepUs(echo);
+            b.gpio.level[pin] = LOW;
+            isrCycleStamp() = fallCycles;
+            b.gpio.fireIsr(pin);
+            isrCycleStamp() = 0;
+        } else {
+            Board* target = &b;
+            std::thread([target, pin, echo, fallCycles]() {
+                target->clock.sleepUs(echo);
+                target->gpio.level[pin] = LOW;
+                isrCycleStamp() = fallCycles;
+                target->gpio.fireIsr(pin);
+            }).detach();
+        }
+        return;
+    }
+}
+
+} // namespace sim
+
+inline void digitalWrite(uint8_t pin, uint8_t value) {
+    sim::Board& b = sim::board();
+    sim::Gpio& gpio = b.gpio;
+    if (gpio.level[pin] == LOW && value == HIGH) {
+        gpio.riseUs[pin] = b.clock.micros();
+    }
+    // A short HIGH pulse on an output is a sonar trigger
+    if (gpio.level[pin] == HIGH && value == LOW && gpio.mode[pin] == OUTPUT &&
+        b.clock.micros() - gpio.riseUs[pin] <= b.sonar.maxTriggerUs) {
+        gpio.level[pin] = value;
+        sim::Sonar& sonar = sim::sonarForTrigger(pin);
+        sonar.armed = true;
+        sonar.pings++;
+        sim::deliverSonarEcho(sonar);
+        return;
+    }
+    gpio.level[pin] = value;
+}
+
+inline int digitalRead(uint8_t pin) {
+    return sim::board().gpio.level[pin];
+}
+
+inline int analogRead(uint8_t pin) {
+    return sim::board().gpio.analog[pin];
+}
+
+/**
+ * ESP32 calibrated read, with the ideal 12-bit / 3.3 V transfer
+ */
+inline uint32_t analogReadMilliVolts(uint8_t pin) {
+    return (uint32_t)sim::board().gpio.analog[pin] * 3300 / 4095;
+}
+
+/**
+ * Measure a pulse on the simulated sonar echo line
+ * Blocks for the echo time (or the timeout) like the real pulseIn
+ */
+inline unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000UL) {
+    sim::Sonar& sonar = sim::board().sonar;
+    if (state != HIGH || !sonar.armed || (sonar.echoPin >= 0 && sonar.echoPin != pin)) {
+        sim::board().clock.sleepUs(timeout);
+        return 0;
+    }
+    sonar.armed = false;
+
+    unsigned long echo = sonar.echoUs();
+    if (echo == 0 || echo > timeout) {
+        sim::board().clock.sleepUs(timeout);
+        return 0;
+    }
+    sim::board().clock.sleepUs(echo);
+    return echo;
+}
+
+// ==================== STRING ====================
+
+class String {
+public:
+    String() {}
+    String(const char* s) : value(s ? s : "") {}
+    String(const std::string& s) : value(s) {}
+    explicit String(int n) : value(std::to_string(n)) {}
+    explicit String(long n) : value(std::to_string(n)) {}
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return (unsigned int)value.size(); }
+    char operator[](unsigned int i) const { return value[i]; }
+
+    void trim() {
+        size_t begin = value.find_first_not_of(" \t\r\n");
+        size_t end = value.find_last_not_of(" \t\r\n");
+        value = (begin == std::string::npos) ? "" : value.substr(begin, end - begin + 1);
+    }
+
+    String& operator+=(char c) { value += c; return *this; }
+    String& operator+=(const char* s) { value += s; return *this; }
+    String& operator+=(const String& s) { value += s.value; return *this; }
+    bool operator==(const char* s) const { return value == s; }
+    bool operator==(const String& s) const { return value == s.value; }
+
+private:
+    std::string value;
+};
+
+// ==================== PRINT ====================
+
+class Print;
+
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) {
+            n += write(*buffer++);
+        }
+        return n;
+    }
+
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(int n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(long n, int base = DEC) {
+        char buf[24];
+        snprintf(buf, sizeof(buf), base == HEX ? "%lx" : "%ld", n);
+        return write(buf);
+    }
+    size_t print(unsigned long n, int base = DEC) {
+        char buf[24];
+        snprintf(buf, sizeof(buf), base == HEX ? "%lx" : "%lu", n);
+        return write(buf);
+    }
+    size_t print(double n, int digits = 2) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.*f", digits, n);
+        return write(buf);
+    }
+    size_t print(const Printable& p) { return p.printTo(*this); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T& value) { size_t n = print(value); return n + println(); }
+    template <typename T>
+    size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+// ==================== SERIAL ====================
+
+/**
+ * Serial port backed by the simulated board UART
+ */
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long baud) { sim::board().uart.baud = baud; }
+    void end() {}
+    void setTimeout(unsigned long ms) { timeoutMs = ms; }
+    explicit operator bool() const { return true; }
+
+    int available() {
+        sim::Uart& uart = sim::board().uart;
+        std::lock_guard<std::mutex> guard(uart.lock);
+        return (int)uart.rx.size();
+    }
+
+    int peek() {
+        sim::Uart& uart = sim::board().uart;
+        std::lock_guard<std::mutex> guard(uart.lock);
+        return uart.rx.empty() ? -1 : uart.rx.front();
+    }
+
+    int read() {
+        sim::Uart& uart = sim::board().uart;
+        std::lock_guard<std::mutex> guard(uart.lock);
+        if (uart.rx.empty()) {
+            return -1;
+        }
+        int c = uart.rx.front();
+        uart.rx.pop_front();
+        uart.rxBytes++;
+        return c;
+    }
+
+    /**
+     * Read until terminator, waiting up to the Stream timeout for more data
+     */
+    String readStringUntil(char terminator) {
+        String result;
+        unsigned long start = millis();
+        for (;;) {
+            int c = read();
+            if (c < 0) {
+                if (millis() - start >= timeoutMs) {
+                    break;
+                }
+                delay(1);
+                continue;
+            }
+            if (c == terminator) {
+                break;
+            }
+            result += (char)c;
+        }
+        return result;
+    }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        sim::Uart& uart = sim::board().uart;
+        std::lock_guard<std::mutex> guard(uart.lock);
+        uart.txBytes += size;
+        if (uart.onTx) {
+            uart.onTx(buffer, size);
+        } else if (uart.captureTx) {
+            uart.tx.insert(uart.tx.end(), buffer, buffer + size);
+        } else {
+            fwrite(buffer, 1, size, stdout);
+            fflush(stdout);
+        }
+        return size;
+    }
+    using Print::write;
+
+    void flush() {}
+
+private:
+    unsigned long timeoutMs = 1000;
+};
+
+inline HardwareSerial Serial;
+
+#endif // SIM_ARDUINO_H
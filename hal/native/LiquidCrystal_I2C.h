@@ -0,0 +1,57 @@
+/**
+ * Native HAL - LiquidCrystal_I2C
+ * Character LCD rendered into the simulated board framebuffer
+ */
+
+#ifndef SIM_LIQUIDCRYSTAL_I2C_H
+#define SIM_LIQUIDCRYSTAL_I2C_H
+
+#include "Arduino.h"
+
+// I2C bytes per HD44780 byte in 4-bit mode (two nibbles, each strobed EN high/low)
+const int SIM_LCD_BUS_BYTES_PER_WRITE = 4;
+
+class LiquidCrystal_I2C : public Print {
+public:
+    LiquidCrystal_I2C(uint8_t address, uint8_t cols, uint8_t rows)
+        : cols(cols), rows(rows) { (void)address; }
+
+    void init() { sim::board().lcd.reset(); }
+    void begin() { init(); }
+
+    void backlight() { sim::board().lcd.backlight = true; }
+    void noBacklight() { sim::board().lcd.backlight = false; }
+
+    void clear() {
+        sim::Lcd& lcd = sim::board().lcd;
+        lcd.reset();
+        lcd.clears++;
+        lcd.busBytes += SIM_LCD_BUS_BYTES_PER_WRITE;
+        // HD44780 clear takes ~1.5 ms, the library waits 2 ms
+        delayMicroseconds(2000);
+    }
+
+    void setCursor(uint8_t col, uint8_t row) {
+        sim::Lcd& lcd = sim::board().lcd;
+        lcd.col = col;
+        lcd.row = row < rows ? row : rows - 1;
+        lcd.busBytes += SIM_LCD_BUS_BYTES_PER_WRITE;
+    }
+
+    size_t write(uint8_t c) override {
+        sim::Lcd& lcd = sim::board().lcd;
+        if (lcd.col < cols && lcd.col < sim::SIM_LCD_COLS) {
+            lcd.text[lcd.row][lcd.col] = (char)c;
+        }
+        lcd.col++;
+        lcd.busBytes += SIM_LCD_BUS_BYTES_PER_WRITE;
+        return 1;
+    }
+    using Print::write;
+
+private:
+    uint8_t cols;
+    uint8_t rows;
+};
+
+#endif // SIM_LIQUIDCRYSTAL_I2C_H
@@ -0,0 +1,109 @@
+/**
+ * Native HAL - LittleFS
+ * Flash filesystem backed by a host directory ($SIM_FS_DIR, default /tmp/sim_littlefs)
+ */
+
+#ifndef SIM_LITTLEFS_H
+#define SIM_LITTLEFS_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/stat.h>
+#include "Arduino.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+class File {
+public:
+    File() {}
+    explicit File(FILE* handle) : handle(handle) {}
+
+    explicit operator bool() const { return handle != nullptr; }
+
+    size_t write(const uint8_t* buffer, size_t size) {
+        return handle ? fwrite(buffer, 1, size, handle) : 0;
+    }
+
+    size_t read(uint8_t* buffer, size_t size) {
+        return handle ? fread(buffer, 1, size, handle) : 0;
+    }
+
+    bool seek(uint32_t position) {
+        return handle && fseek(handle, (long)position, SEEK_SET) == 0;
+    }
+
+    size_t position() { return handle ? (size_t)ftell(handle) : 0; }
+
+    size_t size() {
+        if (!handle) {
+            return 0;
+        }
+        long here = ftell(handle);
+        fseek(handle, 0, SEEK_END);
+        long end = ftell(handle);
+        fseek(handle, here, SEEK_SET);
+        return (size_t)end;
+    }
+
+    void flush() {
+        if (handle) {
+            fflush(handle);
+        }
+    }
+
+    void close() {
+        if (handle) {
+            fclose(handle);
+            handle = nullptr;
+        }
+    }
+
+private:
+    FILE* handle = nullptr;
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool formatOnFail = false) {
+        (void)formatOnFail;
+        const char* dir = getenv("SIM_FS_DIR");
+        root = dir ? dir : "/tmp/sim_littlefs";
+        mkdir(root.c_str(), 0755);
+        return true;
+    }
+
+    File open(const char* path, const char* mode = FILE_READ) {
+        std::string fopenMode = std::string(mode) + "b";
+        if (fopenMode == "ab") {
+            fopenMode = "a+b";
+        }
+        return File(fopen(hostPath(path).c_str(), fopenMode.c_str()));
+    }
+
+    bool exists(const char* path) {
+        struct stat info;
+        return stat(hostPath(path).c_str(), &info) == 0;
+    }
+
+    bool remove(const char* path) {
+        return ::remove(hostPath(path).c_str()) == 0;
+    }
+
+private:
+    std::string hostPath(const char* path) const { return root + path; }
+
+    std::string root;
+};
+
+} // namespace fs
+
+using fs::File;
+
+inline fs::LittleFSFS LittleFS;
+
+#endif // SIM_LITTLEFS_H
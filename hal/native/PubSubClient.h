@@ -0,0 +1,124 @@
+/**
+ * Native HAL - PubSubClient
+ * MQTT client talking to the simulated broker of the current board
+ */
+
+#ifndef SIM_PUBSUBCLIENT_H
+#define SIM_PUBSUBCLIENT_H
+
+#include "Arduino.h"
+#include "WiFi.h"
+
+// ==================== CONSTANTS ====================
+
+#define MQTT_CONNECTION_TIMEOUT     -4
+#define MQTT_CONNECTION_LOST        -3
+#define MQTT_CONNECT_FAILED         -2
+#define MQTT_DISCONNECTED           -1
+#define MQTT_CONNECTED               0
+
+#define MQTT_CALLBACK_SIGNATURE void (*callback)(char*, uint8_t*, unsigned int)
+
+// ==================== CLIENT ====================
+
+class PubSubClient {
+public:
+    explicit PubSubClient(Client& client) { (void)client; }
+
+    PubSubClient& setServer(const char* domain, uint16_t port) {
+        (void)domain;
+        (void)port;
+        return *this;
+    }
+
+    bool setBufferSize(uint16_t size) {
+        bufferSize = size;
+        return true;
+    }
+
+    PubSubClient& setSocketTimeout(uint16_t timeout) {
+        (void)timeout;
+        return *this;
+    }
+
+    PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE) {
+        this->callback = callback;
+        return *this;
+    }
+
+    /**
+     * Connect to the simulated broker (blocks for the configured connect cost)
+     */
+    bool connect(const char* id) {
+        (void)id;
+        sim::Net& net = sim::board().net;
+        net.connectAttempts++;
+        delay(net.connectCostMs);
+        isConnected = WiFi.status() == WL_CONNECTED && net.brokerUp;
+        lastState = isConnected ? MQTT_CONNECTED : MQTT_CONNECT_FAILED;
+        return isConnected;
+    }
+
+    void disconnect() {
+        isConnected = false;
+        lastState = MQTT_DISCONNECTED;
+    }
+
+    bool connected() {
+        if (isConnected && (WiFi.status() != WL_CONNECTED || !sim::board().net.brokerUp)) {
+            isConnected = false;
+            lastState = MQTT_CONNECTION_LOST;
+        }
+        return isConnected;
+    }
+
+    bool loop() { return connected(); }
+
+    bool publish(const char* topic, const char* payload) {
+        return publish(topic, (const uint8_t*)payload, (unsigned int)strlen(payload), false);
+    }
+
+    bool publish(const char* topic, const char* payload, bool retained) {
+        return publish(topic, (const uint8_t*)payload, (unsigned int)strlen(payload), retained);
+    }
+
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length) {
+        return publish(topic, payload, length, false);
+    }
+
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+        (void)retained;
+        // Same limit as the real client: header + topic + payload must fit the buffer
+        if (!connected() || 5 + 2 + strlen(topic) + length > bufferSize) {
+            return false;
+        }
+        sim::Net& net = sim::board().net;
+        net.publishCount++;
+        net.publishBytes += length;
+        if (net.onPublish) {
+            net.onPublish(topic, payload, length);
+        } else {
+            printf("[broker] %s: ", topic);
+            for (unsigned int i = 0; i < length; i++) {
+                if (payload[i] >= 0x20 && payload[i] < 0x7f) {
+                    putchar(payload[i]);
+                } else {
+                    printf("\\x%02x", payload[i]);
+                }
+            }
+            putchar('\n');
+            fflush(stdout);
+        }
+        return true;
+    }
+
+    int state() { return lastState; }
+
+private:
+    MQTT_CALLBACK_SIGNATURE = nullptr;
+    uint16_t bufferSize = 256;
+    bool isConnected = false;
+    int lastState = MQTT_DISCONNECTED;
+};
+
+#endif // SIM_PUBSUBCLIENT_H
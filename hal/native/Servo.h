@@ -0,0 +1,34 @@
+/**
+ * Native HAL - Servo
+ * Hobby servo driven through the simulated board
+ */
+
+#ifndef SIM_SERVO_H
+#define SIM_SERVO_H
+
+#include "Arduino.h"
+
+class Servo {
+public:
+    uint8_t attach(int pin) {
+        sim::board().servo.pin = pin;
+        attachedPin = pin;
+        return 0;
+    }
+
+    void detach() { attachedPin = -1; }
+    bool attached() { return attachedPin >= 0; }
+
+    void write(int angle) {
+        sim::ServoState& servo = sim::board().servo;
+        servo.angle = constrain(angle, 0, 180);
+        servo.writes++;
+    }
+
+    int read() { return sim::board().servo.angle; }
+
+private:
+    int attachedPin = -1;
+};
+
+#endif // SIM_SERVO_H
@@ -0,0 +1,259 @@
+/**
+ * Native HAL - Microbenchmark Harness
+ * Small Google Benchmark style runner for the host [env:bench] builds:
+ * register named bodies, each is timed over an auto-calibrated number of
+ * iterations and the median of several repeats is reported.
+ *
+ * Output is an aligned table, or one JSON object per benchmark (--json) that
+ * can be saved (--out) and compared against on the next run (--baseline).
+ * Target cycles are first-order estimates: host cycles scaled by the
+ * CoreMark/MHz ratio of the host and the target core. They rank hot paths
+ * and show before/after changes; the on-target timing (WCS scheduler
+ * reports, TMS diagnostics) remains the reference.
+ *
+ * Options: --filter TEXT  --repeats N  --min-ms MS  --json  --out FILE
+ *          --baseline FILE  --host-mhz MHZ  --host-coremark-mhz N
+ */
+
+#ifndef SIM_BENCH_H
+#define SIM_BENCH_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+// ==================== TARGETS ====================
+
+struct BenchTarget {
+    const char* name;
+    double mhz;
+    double coremarkPerMhz;
+};
+
+// ATmega328P (avr-gcc, 8-bit core: 32-bit and float work cost more than this suggests)
+const BenchTarget BENCH_AVR = { "avr", 16, 0.46 };
+// ESP32-S3 Xtensa LX7, one core
+const BenchTarget BENCH_XTENSA = { "xtensa", 240, 2.56 };
+
+const double BENCH_HOST_COREMARK_PER_MHZ = 6.0;  // Recent x86-64 / ARM64 core
+const double BENCH_HOST_DEFAULT_MHZ = 3000;
+
+// ==================== REGISTRATION ====================
+
+/**
+ * Keep a value alive so the optimizer cannot drop the work producing it
+ */
+template <typename T>
+inline void benchKeep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchCase {
+    std::string name;
+    std::function<void()> body;
+};
+
+inline std::vector<BenchCase>& benchCases() {
+    static std::vector<BenchCase> cases;
+    return cases;
+}
+
+inline void benchRegister(const char* name, std::function<void()> body) {
+    benchCases().push_back({ name, std::move(body) });
+}
+
+// ==================== RUNNER ====================
+
+struct BenchOptions {
+    std::string filter;
+    int repeats = 5;
+    double minMs = 20;       // Per repeat
+    bool json = false;
+    std::string out;
+    std::string baseline;
+    double hostMhz = 0;      // 0 = from /proc/cpuinfo
+    double hostCoremarkPerMhz = BENCH_HOST_COREMARK_PER_MHZ;
+};
+
+/**
+ * Nominal host clock (Linux), BENCH_HOST_DEFAULT_MHZ elsewhere
+ */
+inline double benchHostMhz() {
+    double mhz = 0;
+    if (FILE* cpuinfo = fopen("/proc/cpuinfo", "r")) {
+        char line[256];
+        while (fgets(line, sizeof(line), cpuinfo)) {
+            if (strncmp(line, "cpu MHz", 7) == 0 && strchr(line, ':')) {
+                mhz = atof(strchr(line, ':') + 1);
+                break;
+            }
+        }
+        fclose(cpuinfo);
+    }
+    return mhz > 0 ? mhz : BENCH_HOST_DEFAULT_MHZ;
+}
+
+/**
+ * ns/op of one benchmark in a previous --json output, 0 if absent
+ */
+inline double benchBaselineNs(const std::string& path, const std::string& name) {
+    double ns = 0;
+    FILE* file = path.empty() ? NULL : fopen(path.c_str(), "r");
+    if (file == NULL) {
+        return 0;
+    }
+    std::string key = "\"name\":\"" + name + "\"";
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+        const char* value = strstr(line, "\"ns_op\":");
+        if (strstr(line, key.c_str()) && value) {
+            ns = atof(value + 8);
+            break;
+        }
+    }
+    fclose(file);
+    return ns;
+}
+
+/**
+ * Time one case: calibrate the iteration count to minMs, then take the
+ * median and minimum ns/op of the repeats
+ */
+inline void benchMeasure(const BenchCase& bench, const BenchOptions& options,
+                         double& medianNs, double& minNs, uint64_t& iterations) {
+    typedef std::chrono::steady_clock Clock;
+    auto timeRun = [&](uint64_t count) {
+        auto start = Clock::now();
+        for (uint64_t i = 0; i < count; i++) {
+            bench.body();
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    };
+
+    iterations = 1;
+    for (;;) {
+        double ns = timeRun(iterations);
+        if (ns >= options.minMs * 1e6 || iterations >= (1ULL << 40)) {
+            break;
+        }
+        uint64_t grown = ns > 0 ? (uint64_t)(iterations * options.minMs * 1.2e6 / ns) : iterations * 10;
+        iterations = std::max(iterations * 2, std::min(grown, iterations * 100));
+    }
+
+    std::vector<double> samples;
+    for (int r = 0; r < options.repeats; r++) {
+        samples.push_back(timeRun(iterations) / iterations);
+    }
+    std::sort(samples.begin(), samples.end());
+    medianNs = samples[samples.size() / 2];
+    minNs = samples[0];
+}
+
+/**
+ * Parse the options and run every registered case matching the filter
+ * @param suite Name written in every JSON record (e.g. "wcs")
+ * @return Process exit code
+ */
+inline int benchMain(int argc, char** argv, const char* suite) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (arg == "--repeats" && hasValue) {
+            options.repeats = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--min-ms" && hasValue) {
+            options.minMs = atof(argv[++i]);
+        } else if (arg == "--out" && hasValue) {
+            options.out = argv[++i];
+        } else if (arg == "--baseline" && hasValue) {
+            options.baseline = argv[++i];
+        } else if (arg == "--host-mhz" && hasValue) {
+            options.hostMhz = atof(argv[++i]);
+        } else if (arg == "--host-coremark-mhz" && hasValue) {
+            options.hostCoremarkPerMhz = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--filter TEXT] [--repeats N] [--min-ms MS] [--json] [--out FILE]\n"
+                            "       [--baseline FILE] [--host-mhz MHZ] [--host-coremark-mhz N]\n", argv[0]);
+            return 1;
+        }
+    }
+    double hostMhz = options.hostMhz > 0 ? options.hostMhz : benchHostMhz();
+    FILE* out = options.out.empty() ? NULL : fopen(options.out.c_str(), "w");
+    if (!options.out.empty() && out == NULL) {
+        fprintf(stderr, "Cannot write %s\n", options.out.c_str());
+        return 1;
+    }
+
+    if (!options.json) {
+        printf("%s benchmarks, host %.0f MHz, estimates: AVR %.0f MHz, Xtensa %.0f MHz\n",
+               suite, hostMhz, BENCH_AVR.mhz, BENCH_XTENSA.mhz);
+        printf("%-28s %10s %10s %10s %12s %10s %12s %10s%s\n", "benchmark", "ns/op", "min ns", "host cyc",
+               "AVR cyc", "AVR us", "Xtensa cyc", "Xtensa us", options.baseline.empty() ? "" : "   vs base");
+    }
+
+    for (const BenchCase& bench : benchCases()) {
+        if (!options.filter.empty() && bench.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        double medianNs;
+        double minNs;
+        uint64_t iterations;
+        benchMeasure(bench, options, medianNs, minNs, iterations);
+
+        double hostCycles = medianNs * hostMhz / 1000;
+        double avrCycles = hostCycles * options.hostCoremarkPerMhz / BENCH_AVR.coremarkPerMhz;
+        double xtensaCycles = hostCycles * options.hostCoremarkPerMhz / BENCH_XTENSA.coremarkPerMhz;
+        double baseNs = benchBaselineNs(options.baseline, bench.name);
+        double deltaPct = baseNs > 0 ? 100.0 * (medianNs - baseNs) / baseNs : 0;
+
+        char record[512];
+        int length = snprintf(record, sizeof(record),
+            "{\"suite\":\"%s\",\"name\":\"%s\",\"ns_op\":%.2f,\"ns_min\":%.2f,\"iterations\":%llu,"
+            "\"host_cycles\":%.0f,\"avr_cycles_est\":%.0f,\"avr_us_est\":%.2f,"
+            "\"xtensa_cycles_est\":%.0f,\"xtensa_us_est\":%.3f",
+            suite, bench.name.c_str(), medianNs, minNs, (unsigned long long)iterations, hostCycles,
+            avrCycles, avrCycles / BENCH_AVR.mhz, xtensaCycles, xtensaCycles / BENCH_XTENSA.mhz);
+        if (baseNs > 0 && length < (int)sizeof(record)) {
+            length += snprintf(record + length, sizeof(record) - length,
+                               ",\"base_ns_op\":%.2f,\"delta_pct\":%.1f", baseNs, deltaPct);
+        }
+        if (length < (int)sizeof(record)) {
+            snprintf(record + length, sizeof(record) - length, "}");
+        }
+
+        if (out != NULL) {
+            fprintf(out, "%s\n", record);
+        }
+        if (options.json) {
+            printf("%s\n", record);
+        } else {
+            printf("%-28s %10.1f %10.1f %10.0f %12.0f %10.2f %12.0f %10.3f", bench.name.c_str(), medianNs, minNs,
+                   hostCycles, avrCycles, avrCycles / BENCH_AVR.mhz, xtensaCycles, xtensaCycles / BENCH_XTENSA.mhz);
+            if (baseNs > 0) {
+                printf("   %+7.1f%%", deltaPct);
+            }
+            printf("\n");
+        }
+        fflush(stdout);
+    }
+
+    if (out != NULL) {
+        fclose(out);
+    }
+    return 0;
+}
+
+} // namespace sim
+
+#endif // SIM_BENCH_H
@@ -0,0 +1,284 @@
+/**
+ * Native HAL - Simulated Board
+ * State behind the host-native backends (clock, GPIO, sonar, UART, network, servo, LCD)
+ * Used by the [env:native] builds of TMS and WCS
+ */
+
+#ifndef SIM_BOARD_H
+#define SIM_BOARD_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace sim {
+
+// ==================== CLOCK ====================
+
+/**
+ * Board clock
+ * Real mode follows the host steady clock, virtual mode only moves when advanced
+ */
+class Clock {
+public:
+    Clock() : origin(std::chrono::steady_clock::now()) {}
+
+    uint64_t micros() const {
+        if (isVirtual) {
+            return virtualUs.load();
+        }
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - origin).count();
+    }
+
+    /**
+     * Block the caller for the given time (advances time in virtual mode)
+     */
+    void sleepUs(uint64_t us) {
+        if (isVirtual) {
+            virtualUs += us;
+        } else if (us > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(us));
+        }
+    }
+
+    bool isVirtualTime() const {
+        return isVirtual;
+    }
+
+    void setVirtual(bool enabled, uint64_t startUs = 0) {
+        isVirtual = enabled;
+        virtualUs = startUs;
+    }
+
+    void advanceTo(uint64_t us) {
+        if (us > virtualUs.load()) {
+            virtualUs = us;
+        }
+    }
+
+private:
+    std::chrono::steady_clock::time_point origin;
+    bool isVirtual = false;
+    std::atomic<uint64_t> virtualUs{0};
+};
+
+// ==================== GPIO ====================
+
+const int SIM_PIN_COUNT = 64;
+
+const uint32_t SIM_CPU_MHZ = 240;
+const uint32_t SIM_HEAP_BYTES = 320 * 1024;  // Nominal, host allocations are not tracked
+
+struct Gpio {
+    std::atomic<int> level[SIM_PIN_COUNT] = {};
+    std::atomic<int> mode[SIM_PIN_COUNT] = {};
+    std::atomic<int> analog[SIM_PIN_COUNT] = {};
+    uint64_t riseUs[SIM_PIN_COUNT] = {};
+    void (*isr[SIM_PIN_COUNT])() = {};
+    void (*isrWithArg[SIM_PIN_COUNT])(void*) = {};  // attachInterruptArg handlers
+    void* isrArg[SIM_PIN_COUNT] = {};
+
+    bool hasIsr(int pin) const { return isr[pin] || isrWithArg[pin]; }
+
+    void fireIsr(int pin) {
+        if (isr[pin]) {
+            isr[pin]();
+        } else if (isrWithArg[pin]) {
+            isrWithArg[pin](isrArg[pin]);
+        }
+    }
+};
+
+// ==================== SONAR ====================
+
+/**
+ * Simulated HC-SR04 style sonar
+ * A short trigger pulse arms it; the echo is then either measured by pulseIn
+ * or delivered as two edges to an interrupt attached on the echo pin
+ */
+struct Sonar {
+    int trigPin = -1;                   // -1 = any output (only for Board::sonar)
+    int echoPin = -1;                   // -1 = answer on any pin
+    std::atomic<float> distanceCm{50.0f};
+    float soundSpeedCmPerUs = 0.0343f;  // Physical speed used to build the echo
+    float maxRangeCm = 400.0f;          // Beyond this the sensor never sees the echo
+    unsigned long maxTriggerUs = 5000;  // Longer HIGH pulses are not triggers (e.g. LEDs)
+    std::atomic<bool> armed{false};
+    std::atomic<uint32_t> pings{0};
+
+    /**
+     * Round trip echo time for the current distance
+     * @return Echo pulse width in us, or 0 if the target is out of range
+     */
+    unsigned long echoUs() const {
+        float d = distanceCm.load();
+        if (d <= 0 || d > maxRangeCm) {
+            return 0;
+        }
+        return (unsigned long)(2.0f * d / soundSpeedCmPerUs);
+    }
+};
+
+const int SIM_EXTRA_SONARS = 4;
+
+// ==================== UART ====================
+
+/**
+ * Simulated UART
+ * TX is echoed to stdout unless captured or hooked (e.g. by a simulated serial link)
+ */
+struct Uart {
+    std::mutex lock;
+    std::deque<uint8_t> rx;
+    std::deque<uint8_t> tx;
+    bool captureTx = false;
+    unsigned long baud = 0;
+    uint64_t txBytes = 0;
+    uint64_t rxBytes = 0;
+
+    // Optional TX hook (e.g. a timed serial line), called on every write at the
+    // baud rate in force; takes precedence over captureTx
+    std::function<void(const uint8_t* data, size_t length)> onTx;
+
+    void inject(const std::string& data) {
+        std::lock_guard<std::mutex> guard(lock);
+        rx.insert(rx.end(), data.begin(), data.end());
+    }
+
+    std::string drainTx() {
+        std::lock_guard<std::mutex> guard(lock);
+        std::string out(tx.begin(), tx.end());
+        tx.clear();
+        return out;
+    }
+};
+
+// ==================== NETWORK ====================
+
+/**
+ * Simulated WiFi access point and MQTT broker
+ */
+struct Net {
+    std::atomic<bool> wifiUp{true};
+    std::atomic<bool> brokerUp{true};
+    unsigned long wifiJoinMs = 200;     // Association time after WiFi.begin()
+    unsigned long connectCostMs = 0;    // Time a broker connect attempt blocks for
+    std::atomic<uint32_t> connectAttempts{0};
+    std::atomic<uint32_t> publishCount{0};
+    std::atomic<uint64_t> publishBytes{0};
+
+    // Optional broker hook, otherwise publishes are printed
+    std::function<void(const char* topic, const uint8_t* payload, unsigned int length)> onPublish;
+};
+
+// ==================== SERVO ====================
+
+struct ServoState {
+    int pin = -1;
+    std::atomic<int> angle{0};
+    std::atomic<uint32_t> writes{0};
+};
+
+// ==================== LCD ====================
+
+const int SIM_LCD_COLS = 20;
+const int SIM_LCD_ROWS = 4;
+
+/**
+ * Simulated HD44780 behind a PCF8574 I2C backpack
+ * busBytes counts I2C bytes: one per nibble-strobe pair, 4 per data/command byte
+ */
+struct Lcd {
+    char text[SIM_LCD_ROWS][SIM_LCD_COLS + 1] = {};
+    int col = 0;
+    int row = 0;
+    bool backlight = false;
+    uint64_t busBytes = 0;
+    uint32_t clears = 0;
+
+    void reset() {
+        for (int r = 0; r < SIM_LCD_ROWS; r++) {
+            for (int c = 0; c < SIM_LCD_COLS; c++) {
+                text[r][c] = ' ';
+            }
+            text[r][SIM_LCD_COLS] = '\0';
+        }
+        col = 0;
+        row = 0;
+    }
+};
+
+// ==================== POWER ====================
+
+/**
+ * Simulated sleep controller
+ * Deep sleep keeps the board clock running and restarts the sketch; time
+ * since boot (micros, millis, esp_timer, ticks) restarts at the wake-up.
+ * Host RAM is not cleared, so globals outside RTC_DATA_ATTR survive too.
+ */
+struct Power {
+    uint64_t bootUs = 0;            // Board clock at the last (re)boot
+    uint64_t wakeTimerUs = 0;       // Armed deep-sleep timer
+    int wakeCause = 0;              // esp_sleep_wakeup_cause_t of the last boot
+    uint32_t deepSleeps = 0;
+    uint64_t deepSleepUs = 0;
+    bool lightSleepEnabled = false;
+    int modemSleep = 1;             // wifi_ps_type_t, the Arduino default is min modem
+};
+
+/**
+ * Thrown by esp_deep_sleep_start() to unwind back into sim::run()
+ */
+struct DeepSleepReset {};
+
+// ==================== BOARD ====================
+
+struct Board {
+    Clock clock;
+    Gpio gpio;
+    Sonar sonar;                        // Default sensor
+    Sonar extraSonars[SIM_EXTRA_SONARS];  // Multi-channel setups, matched by trigPin
+    Uart uart;
+    Net net;
+    ServoState servo;
+    Lcd lcd;
+    Power power;
+
+    Board() { lcd.reset(); }
+};
+
+/**
+ * Board the native HAL currently talks to
+ * Multi-node simulations switch it with select() before stepping a node
+ */
+inline Board*& currentBoard() {
+    static Board defaultBoard;
+    static Board* current = &defaultBoard;
+    return current;
+}
+
+inline Board& board() {
+    return *currentBoard();
+}
+
+inline void select(Board& b) {
+    currentBoard() = &b;
+}
+
+/**
+ * Time since the current board last booted or woke from deep sleep
+ */
+inline uint64_t uptimeUs() {
+    return board().clock.micros() - board().power.bootUs;
+}
+
+} // namespace sim
+
+#endif // SIM_BOARD_H
@@ -0,0 +1,69 @@
+/**
+ * Native HAL - Entry Point
+ * Runs an Arduino sketch (setup/loop) on the host against the simulated board
+ *
+ * Environment overrides:
+ *   SIM_SONAR_CM  - distance seen by the sonar (cm)
+ *   SIM_POT       - potentiometer ADC reading (0-1023) on A0
+ *   SIM_BROKER    - 0 to start with the MQTT broker down
+ * Lines typed on stdin are delivered to the Serial RX buffer.
+ */
+
+#ifndef SIM_MAIN_H
+#define SIM_MAIN_H
+
+#include "Arduino.h"
+
+namespace sim {
+
+inline void applyEnvironment() {
+    Board& b = board();
+    if (const char* v = getenv("SIM_SONAR_CM")) {
+        b.sonar.distanceCm = (float)atof(v);
+    }
+    if (const char* v = getenv("SIM_POT")) {
+        b.gpio.analog[A0] = atoi(v);
+    }
+    if (const char* v = getenv("SIM_BROKER")) {
+        b.net.brokerUp = atoi(v) != 0;
+    }
+}
+
+/**
+ * Forward stdin to the Serial RX buffer of the current board
+ */
+inline void startStdinPump() {
+    Board* target = &board();
+    std::thread([target]() {
+        int c;
+        while ((c = getchar()) != EOF) {
+            target->uart.inject(std::string(1, (char)c));
+        }
+    }).detach();
+}
+
+/**
+ * Run setup() once and loop() forever, like the Arduino core main()
+ * A deep sleep restarts the sketch from setup() after the wake-up timer
+ */
+inline int run(void (*setup)(), void (*loop)()) {
+    applyEnvironment();
+    startStdinPump();
+    for (;;) {
+        try {
+            setup();
+            for (;;) {
+                loop();
+                // Keep a busy sketch loop from pinning a host core
+                board().clock.sleepUs(100);
+            }
+        } catch (const DeepSleepReset&) {
+            continue;
+        }
+    }
+    return 0;
+}
+
+} // namespace sim
+
+#endif // SIM_MAIN_H
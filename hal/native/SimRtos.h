@@ -0,0 +1,154 @@
+/**
+ * Native HAL - FreeRTOS Shim
+ * Tasks run as host threads, delays go through the simulated board clock
+ */
+
+#ifndef SIM_RTOS_H
+#define SIM_RTOS_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "SimBoard.h"
+
+// ==================== TYPES ====================
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void (*TaskFunction_t)(void*);
+
+struct SimTask {
+    const char* name;
+    UBaseType_t priority;
+    int core;
+    uint32_t stackDepth;
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t notifyValue = 0;
+};
+typedef SimTask* TaskHandle_t;
+
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define pdFALSE 0
+#define tskNO_AFFINITY 0x7fffffff
+#define tskIDLE_PRIORITY 0
+#define portYIELD_FROM_ISR(...)
+
+namespace sim {
+
+/**
+ * Task record of the calling thread (threads not created by xTaskCreate get one lazily)
+ */
+inline SimTask*& currentTask() {
+    thread_local SimTask* task = nullptr;
+    if (!task) {
+        task = new SimTask{"native", 1, tskNO_AFFINITY, 0};
+    }
+    return task;
+}
+
+} // namespace sim
+
+// ==================== TASK API ====================
+
+inline TickType_t xTaskGetTickCount() {
+    return (TickType_t)(sim::uptimeUs() / 1000);
+}
+
+inline void vTaskDelay(TickType_t ticks) {
+    sim::board().clock.sleepUs((uint64_t)ticks * 1000);
+}
+
+inline void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment) {
+    TickType_t next = *previousWakeTime + increment;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(next - now) > 0) {
+        vTaskDelay(next - now);
+    }
+    *previousWakeTime = next;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name,
+                                          uint32_t stackDepth, void* parameter,
+                                          UBaseType_t priority, TaskHandle_t* handle,
+                                          BaseType_t core) {
+    SimTask* task = new SimTask{name, priority, core, stackDepth};
+    std::thread([task, function, parameter]() {
+        sim::currentTask() = task;
+        function(parameter);
+    }).detach();
+    if (handle) {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t function, const char* name,
+                              uint32_t stackDepth, void* parameter,
+                              UBaseType_t priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(function, name, stackDepth, parameter,
+                                   priority, handle, tskNO_AFFINITY);
+}
+
+/**
+ * Host threads have no FreeRTOS stack to watch: report the configured depth
+ */
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return task ? task->stackDepth : 0;
+}
+
+// ==================== TASK NOTIFICATIONS ====================
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return sim::currentTask();
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->notifyValue++;
+    }
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    xTaskNotifyGive(task);
+    if (higherPriorityTaskWoken) {
+        *higherPriorityTaskWoken = pdTRUE;
+    }
+}
+
+/**
+ * Wait for a notification (in virtual time a timeout just advances the clock)
+ */
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+    SimTask* task = sim::currentTask();
+    std::unique_lock<std::mutex> guard(task->lock);
+    if (task->notifyValue == 0 && ticksToWait > 0) {
+        if (sim::board().clock.isVirtualTime()) {
+            guard.unlock();
+            vTaskDelay(ticksToWait);
+            guard.lock();
+        } else if (ticksToWait == portMAX_DELAY) {
+            task->notified.wait(guard, [task]() { return task->notifyValue > 0; });
+        } else {
+            task->notified.wait_for(guard, std::chrono::milliseconds(ticksToWait),
+                                    [task]() { return task->notifyValue > 0; });
+        }
+    }
+    uint32_t value = task->notifyValue;
+    if (value > 0) {
+        task->notifyValue = clearOnExit ? 0 : value - 1;
+    }
+    return value;
+}
+
+#endif // SIM_RTOS_H
@@ -0,0 +1,109 @@
+/**
+ * Native HAL - WiFi
+ * Station-mode WiFi backed by the simulated board network
+ */
+
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include "Arduino.h"
+
+// ==================== TYPES ====================
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1
+} wifi_mode_t;
+
+typedef enum {
+    WIFI_PS_NONE = 0,
+    WIFI_PS_MIN_MODEM = 1,
+    WIFI_PS_MAX_MODEM = 2
+} wifi_ps_type_t;
+
+class IPAddress : public Printable {
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : octets{a, b, c, d} {}
+
+    size_t printTo(Print& p) const override {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+        return p.print(buf);
+    }
+
+    uint8_t operator[](int index) const {
+        return octets[index];
+    }
+
+private:
+    uint8_t octets[4];
+};
+
+/**
+ * Network client base, as consumed by PubSubClient
+ */
+class Client {
+public:
+    virtual ~Client() {}
+};
+
+class WiFiClient : public Client {};
+
+// ==================== WIFI ====================
+
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t m) { currentMode = m; return true; }
+
+    wl_status_t begin(const char* ssid, const char* password) {
+        (void)ssid;
+        (void)password;
+        beginAtMs = millis();
+        started = true;
+        return status();
+    }
+
+    bool disconnect(bool wifiOff = false, bool eraseAp = false) {
+        (void)eraseAp;
+        started = false;
+        if (wifiOff) {
+            currentMode = WIFI_OFF;
+        }
+        return true;
+    }
+
+    bool setSleep(bool enabled) { return setSleep(enabled ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE); }
+    bool setSleep(wifi_ps_type_t type) { sim::board().power.modemSleep = type; return true; }
+    wifi_ps_type_t getSleep() { return (wifi_ps_type_t)sim::board().power.modemSleep; }
+
+    /**
+     * Connected once the simulated join time has elapsed and the AP is up
+     */
+    wl_status_t status() {
+        sim::Net& net = sim::board().net;
+        if (!started || currentMode == WIFI_OFF || !net.wifiUp) {
+            return WL_DISCONNECTED;
+        }
+        return (millis() - beginAtMs >= net.wifiJoinMs) ? WL_CONNECTED : WL_DISCONNECTED;
+    }
+
+    IPAddress localIP() { return status() == WL_CONNECTED ? IPAddress(192, 168, 0, 42) : IPAddress(); }
+
+private:
+    wifi_mode_t currentMode = WIFI_OFF;
+    unsigned long beginAtMs = 0;
+    bool started = false;
+};
+
+inline WiFiClass WiFi;
+
+#endif // SIM_WIFI_H
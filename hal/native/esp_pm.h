@@ -0,0 +1,68 @@
+/**
+ * Native HAL - esp_pm
+ * Power management configuration and locks (recorded, no frequency scaling)
+ */
+
+#ifndef SIM_ESP_PM_H
+#define SIM_ESP_PM_H
+
+#include <atomic>
+#include "SimBoard.h"
+
+// sdkconfig options of a build with power management and tickless idle
+#ifndef CONFIG_PM_ENABLE
+#define CONFIG_PM_ENABLE 1
+#endif
+#ifndef CONFIG_FREERTOS_USE_TICKLESS_IDLE
+#define CONFIG_FREERTOS_USE_TICKLESS_IDLE 1
+#endif
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+
+typedef struct {
+    int max_freq_mhz;
+    int min_freq_mhz;
+    bool light_sleep_enable;
+} esp_pm_config_esp32s3_t;
+
+typedef enum {
+    ESP_PM_CPU_FREQ_MAX,
+    ESP_PM_APB_FREQ_MAX,
+    ESP_PM_NO_LIGHT_SLEEP
+} esp_pm_lock_type_t;
+
+struct SimPmLock {
+    esp_pm_lock_type_t type;
+    std::atomic<int> count{0};
+};
+typedef SimPmLock* esp_pm_lock_handle_t;
+
+inline esp_err_t esp_pm_configure(const void* config) {
+    const esp_pm_config_esp32s3_t* pm = (const esp_pm_config_esp32s3_t*)config;
+    sim::board().power.lightSleepEnabled = pm->light_sleep_enable;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_pm_lock_create(esp_pm_lock_type_t type, int arg, const char* name,
+                                    esp_pm_lock_handle_t* handle) {
+    (void)arg;
+    (void)name;
+    *handle = new SimPmLock();
+    (*handle)->type = type;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle) {
+    handle->count++;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle) {
+    handle->count--;
+    return ESP_OK;
+}
+
+#endif // SIM_ESP_PM_H
@@ -0,0 +1,44 @@
+/**
+ * Native HAL - esp_sleep
+ * Timer wake-up and deep sleep on the simulated board (see sim::Power)
+ */
+
+#ifndef SIM_ESP_SLEEP_H
+#define SIM_ESP_SLEEP_H
+
+#include <cstdint>
+#include "SimBoard.h"
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+
+typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+    ESP_SLEEP_WAKEUP_TIMER = 4
+} esp_sleep_wakeup_cause_t;
+
+inline esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs) {
+    sim::board().power.wakeTimerUs = timeUs;
+    return ESP_OK;
+}
+
+inline esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+    return (esp_sleep_wakeup_cause_t)sim::board().power.wakeCause;
+}
+
+/**
+ * Sleep until the wake-up timer, then reboot the sketch
+ */
+[[noreturn]] inline void esp_deep_sleep_start() {
+    sim::Board& b = sim::board();
+    b.clock.sleepUs(b.power.wakeTimerUs);
+    b.power.deepSleeps++;
+    b.power.deepSleepUs += b.power.wakeTimerUs;
+    b.power.bootUs = b.clock.micros();
+    b.power.wakeCause = ESP_SLEEP_WAKEUP_TIMER;
+    throw sim::DeepSleepReset();
+}
+
+#endif // SIM_ESP_SLEEP_H
@@ -0,0 +1,16 @@
+/**
+ * Native HAL - esp_timer
+ * 64-bit microsecond time base on the simulated board clock
+ */
+
+#ifndef SIM_ESP_TIMER_H
+#define SIM_ESP_TIMER_H
+
+#include <cstdint>
+#include "SimBoard.h"
+
+inline int64_t esp_timer_get_time() {
+    return (int64_t)sim::uptimeUs();
+}
+
+#endif // SIM_ESP_TIMER_H
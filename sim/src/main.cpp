@@ -0,0 +1,1330 @@
+/**
+ * Whole-System Simulator (host)
+ * Discrete-event model of the path from a level crossing to the valve moving:
+ *   rain -> tank -> TMS sampling (sonarTask) and publishing (mqttTask)
+ *   -> broker -> CUS (MQTT handler, TankMonitor, SerialService)
+ *   -> serial line -> WCS sketch -> servo -> tank outflow
+ * The WCS sketch (wcs/src) runs unmodified on the native HAL in virtual time.
+ * The TMS decisions come from its firmware headers (echo conversion, edge
+ * alarms, adaptive period, publish policy); the CUS is modelled on its Java
+ * classes with the defaults of config.properties.
+ * Each rain scenario runs in its own process, so the sketch always starts
+ * from a fresh boot. Results go to stdout, one block (or JSON line) per scenario.
+ *
+ * Run with: pio run -e native -t exec
+ * or: g++ -std=gnu++17 -O2 -DNATIVE_BUILD -I../hal/native src/main.cpp -o system_sim && ./system_sim --help
+ */
+
+#include <Arduino.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ==================== FIRMWARE ====================
+
+// TMS decision logic, namespaced so it can share the program with the WCS sketch
+namespace tms {
+#include "../../tms/src/task/Config.h"
+#include "../../tms/src/task/Level.h"
+#include "../../tms/src/task/AdaptiveSampler.h"
+#include "../../tms/src/task/PublishPolicy.h"
+#include "../../tms/src/task/AlarmEngine.h"
+}
+
+// WCS sketch as-is: setup(), loop() and its globals; main() is ours
+#define SIM_SYSTEM
+#include "../../wcs/src/main.cpp"
+
+// ==================== PLANT CONFIGURATION ====================
+
+const double TANK_HEIGHT_CM = 50.0;      // Overflow level
+const double START_LEVEL_CM = 10.0;
+const double DRAIN_FULL_CM_S = 0.25;     // Outflow with the valve fully open at DRAIN_REF_LEVEL_CM
+const double DRAIN_REF_LEVEL_CM = 40.0;  // Outflow grows with sqrt(level) (Torricelli)
+const uint64_t PHYSICS_STEP_US = 10000;
+
+// ==================== CUS MODEL CONFIGURATION ====================
+// Same values as the Java classes and config.properties
+
+const double CUS_L1_CM = 20.0;                   // tank.l1
+const double CUS_L2_CM = 40.0;                   // tank.l2
+const uint64_t CUS_T1_MS = 10000;                // tank.t1
+const uint64_t CUS_T2_MS = 10000;                // tank.t2
+const uint64_t MONITOR_INTERVAL_MS = 500;        // TankMonitor.UPDATE_INTERVAL_MS
+const uint64_t SERIAL_READ_TIMEOUT_MS = 100;     // SerialService read timeout (loop period when idle)
+const uint64_t HEARTBEAT_INTERVAL_MS = 2000;     // SerialService.HEARTBEAT_INTERVAL_MS
+const uint64_t LINK_TIMEOUT_MS = 5000;           // SerialService.LINK_TIMEOUT_MS
+const uint64_t POLICY_REFRESH_MS = 10000;        // SerialService.POLICY_REFRESH_MS
+const uint64_t COMMAND_TIMEOUT_MS = 500;         // CommandTracker.COMMAND_TIMEOUT_MS
+const int COMMAND_MAX_ATTEMPTS = 4;              // CommandTracker.MAX_ATTEMPTS
+const unsigned long CUS_BAUD = 9600;             // serial.baudrate
+const unsigned long CUS_FAST_BAUD = 250000;      // serial.fastbaud
+
+// TMS mqttTask wait between passes in POWER_ACTIVE (waitForNetworkWork)
+const uint64_t TMS_MQTT_POLL_MS = 100;
+
+// ==================== OPTIONS ====================
+
+struct Options {
+    std::string scenario = "all";
+    double durationS = 3600;
+    uint32_t seed = 1;
+    double brokerLatencyMs = 20;  // TMS -> broker -> CUS
+    double brokerJitterMs = 10;
+    double brokerLoss = 0;
+    double serialLatencyMs = 2;   // USB-serial adapter and driver, each way
+    double serialJitterMs = 1;
+    double serialLoss = 0;
+    bool negotiate = true;        // serial.protocol=auto (binary frames at CUS_FAST_BAUD)
+    bool localControl = true;     // control.local=true
+    bool alerts = true;           // mqtt.topic.alert subscribed
+    uint32_t wcsPassUs = 500;     // One loop() pass on the Uno
+    double noiseCm = 0;           // Sonar noise (standard deviation)
+    bool json = false;
+};
+
+Options options;
+
+// ==================== RAIN SCENARIOS ====================
+
+/**
+ * Rain as the level rise it causes with the valve closed (cm/s)
+ */
+struct Scenario {
+    const char* name;
+    const char* description;
+    double (*rainCmPerS)(double tS);
+};
+
+double drizzleRain(double tS) {
+    return 0.03;
+}
+
+double showersRain(double tS) {
+    return fmod(tS, 360) < 120 ? 0.35 : 0.005;
+}
+
+double stormRain(double tS) {
+    const double peak = 0.35;
+    if (tS < 900) {
+        return peak * tS / 900;
+    }
+    if (tS < 1500) {
+        return peak;
+    }
+    if (tS < 2400) {
+        return peak * (2400 - tS) / 900;
+    }
+    return 0;
+}
+
+double flashRain(double tS) {
+    return fmod(tS, 480) < 40 ? 0.8 : 0.01;
+}
+
+const Scenario SCENARIOS[] = {
+    { "drizzle", "steady 0.03 cm/s: settles around L1 (T1 and close reactions)", drizzleRain },
+    { "showers", "0.35 cm/s for 2 min every 6 min: repeated L2 crossings", showersRain },
+    { "storm", "ramp to 0.35 cm/s, above full drain for 10 min: overflow", stormRain },
+    { "flash", "0.8 cm/s for 40 s every 8 min: fast L2 crossings", flashRain }
+};
+const int SCENARIO_COUNT = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+// ==================== EVENT QUEUE ====================
+
+/**
+ * Time-ordered actions; events at the same time run in scheduling order.
+ * Advancing the queue also advances the board clock the sketch reads
+ */
+class EventQueue {
+public:
+    void at(uint64_t us, std::function<void()> action) {
+        events.push({ us, order++, std::move(action) });
+    }
+
+    uint64_t nextUs() const {
+        return events.empty() ? UINT64_MAX : events.top().us;
+    }
+
+    void runNext() {
+        Event event = events.top();
+        events.pop();
+        advance(event.us);
+        event.action();
+    }
+
+    void advance(uint64_t us) {
+        nowUs = us;
+        sim::board().clock.advanceTo(us);
+    }
+
+    uint64_t now() const {
+        return nowUs;
+    }
+
+private:
+    struct Event {
+        uint64_t us;
+        uint64_t order;
+        std::function<void()> action;
+
+        bool operator>(const Event& other) const {
+            return us != other.us ? us > other.us : order > other.order;
+        }
+    };
+
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    uint64_t order = 0;
+    uint64_t nowUs = 0;
+};
+
+EventQueue events;
+
+uint64_t nowUs() {
+    return events.now();
+}
+
+unsigned long nowMs() {
+    return (unsigned long)(events.now() / 1000);
+}
+
+/**
+ * A task blocked on a timeout or an early notification (ulTaskNotifyTake,
+ * Object.wait): scheduling a new wake-up cancels the pending one
+ */
+struct WakeableTask {
+    uint32_t generation;
+};
+
+void wakeAt(WakeableTask& task, uint64_t us, void (*body)()) {
+    uint32_t generation = ++task.generation;
+    events.at(us, [&task, generation, body]() {
+        if (task.generation == generation) {
+            body();
+        }
+    });
+}
+
+// ==================== RANDOMNESS ====================
+
+std::mt19937 rng;
+
+bool chance(double probability) {
+    return probability > 0 && std::uniform_real_distribution<double>(0, 1)(rng) < probability;
+}
+
+uint64_t delayUs(double latencyMs, double jitterMs) {
+    double jitter = jitterMs > 0 ? std::uniform_real_distribution<double>(0, jitterMs)(rng) : 0;
+    return (uint64_t)((latencyMs + jitter) * 1000);
+}
+
+// ==================== STATISTICS ====================
+
+struct Distribution {
+    std::vector<double> values;
+
+    void add(double value) {
+        values.push_back(value);
+    }
+
+    /**
+     * Nearest-rank percentile (as CommandTracker), 0 without samples
+     */
+    double percentile(int percentile) const {
+        if (values.empty()) {
+            return 0;
+        }
+        std::vector<double> sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+        int rank = (int)ceil(percentile / 100.0 * sorted.size());
+        return sorted[(rank > 1 ? rank : 1) - 1];
+    }
+};
+
+// ==================== TANK ====================
+
+struct Tank {
+    double levelCm;
+    double peakCm;
+    int band;                // tms::levelBand of the true level
+    uint32_t bandChanges;    // Identifies a stay in one band
+    bool overflowing;
+    uint32_t overflowEvents;
+    uint64_t overflowUs;
+    double spilledCm;        // Rain that did not fit, as tank level
+    uint64_t aboveL2Us;
+    double valveIntegral;    // Opening x time, for the mean opening
+};
+
+Tank tank;
+
+/**
+ * Valve opening from the servo angle the sketch wrote (0..1)
+ */
+double valveFraction() {
+    return (double)(sim::board().servo.angle - VALVE_MIN_ANGLE) / (VALVE_MAX_ANGLE - VALVE_MIN_ANGLE);
+}
+
+int32_t levelUnits(double cm) {
+    return (int32_t)lround(cm * tms::LEVEL_UNITS_PER_CM);
+}
+
+// ==================== REACTIONS ====================
+
+/**
+ * Valve reactions the policy owes to the true level
+ *   L2_OPEN:  level rose to L2              -> valve starts opening
+ *   L1_CLOSE: level fell to L1              -> valve starts closing
+ *   T1_HALF:  level stayed above L1 for T1 -> valve starts opening (50%),
+ *             measured from the crossing + T1
+ * Stages: sense = first TMS sample in the new band, network = until the
+ * CUS gets it (level or alert), actuation = until the servo moves
+ */
+enum ReactionKind {
+    REACTION_L2_OPEN,
+    REACTION_L1_CLOSE,
+    REACTION_T1_HALF,
+    REACTION_KIND_COUNT
+};
+
+const char* const REACTION_NAMES[REACTION_KIND_COUNT] = { "l2_open", "l1_close", "t1_half" };
+
+struct Reaction {
+    bool pending;
+    ReactionKind kind;
+    int band;            // Band the level is in after the crossing
+    uint64_t startUs;    // Crossing (or crossing + T1)
+    uint64_t sensedUs;   // 0 = not yet
+    uint64_t cusUs;
+    int fromAngle;
+    int toAngle;
+};
+
+struct ReactionStats {
+    Distribution totalMs;
+    Distribution senseMs;
+    Distribution networkMs;
+    Distribution actuationMs;
+    uint32_t aborted;    // Level left the band before the valve moved
+    uint32_t unneeded;   // Valve already where the policy wants it
+};
+
+Reaction reaction = {};
+ReactionStats reactionStats[REACTION_KIND_COUNT];
+
+/**
+ * Start timing a reaction (replaces one still pending)
+ */
+void expectReaction(ReactionKind kind, int targetPercentage, uint64_t startUs) {
+    if (reaction.pending) {
+        reactionStats[reaction.kind].aborted++;
+    }
+    int angle = sim::board().servo.angle;
+    int target = percentageToAngle(targetPercentage);
+    reaction.pending = false;
+    if (angle == target) {
+        reactionStats[kind].unneeded++;
+        return;
+    }
+    reaction = { true, kind, tank.band, startUs, 0, 0, angle, target };
+}
+
+void onSensed(int32_t level) {
+    if (reaction.pending && reaction.sensedUs == 0 && tms::levelBand(level) == reaction.band) {
+        reaction.sensedUs = nowUs();
+    }
+}
+
+void onCusLevel(double levelCm) {
+    if (reaction.pending && reaction.sensedUs != 0 && reaction.cusUs == 0 &&
+        tms::levelBand(levelUnits(levelCm)) == reaction.band) {
+        reaction.cusUs = nowUs();
+    }
+}
+
+/**
+ * After each WCS pass: has the servo started towards the target?
+ */
+void checkReaction() {
+    if (!reaction.pending) {
+        return;
+    }
+    int angle = sim::board().servo.angle;
+    bool moved = reaction.toAngle > reaction.fromAngle ? angle > reaction.fromAngle : angle < reaction.fromAngle;
+    if (!moved) {
+        return;
+    }
+
+    ReactionStats& stats = reactionStats[reaction.kind];
+    uint64_t now = nowUs();
+    stats.totalMs.add((now - reaction.startUs) / 1000.0);
+    if (reaction.kind != REACTION_T1_HALF && reaction.sensedUs != 0 && reaction.cusUs != 0) {
+        stats.senseMs.add((reaction.sensedUs - reaction.startUs) / 1000.0);
+        stats.networkMs.add((reaction.cusUs - reaction.sensedUs) / 1000.0);
+        stats.actuationMs.add((now - reaction.cusUs) / 1000.0);
+    }
+    reaction.pending = false;
+}
+
+/**
+ * T1 after an L1 crossing: a 50% opening is due if the level never left the band
+ */
+void checkT1(uint32_t bandChanges, uint64_t dueUs) {
+    if (tank.bandChanges == bandChanges && tank.band == 1 && !reaction.pending) {
+        expectReaction(REACTION_T1_HALF, 50, dueUs);
+    }
+}
+
+/**
+ * True level moved to another band
+ */
+void onBandChange(int previous, int band) {
+    tank.band = band;
+    tank.bandChanges++;
+    uint64_t now = nowUs();
+
+    if (band == 2) {
+        expectReaction(REACTION_L2_OPEN, 100, now);
+    } else if (band == 0) {
+        expectReaction(REACTION_L1_CLOSE, 0, now);
+    } else if (previous == 0) {
+        if (reaction.pending) {
+            reactionStats[reaction.kind].aborted++;
+            reaction.pending = false;
+        }
+        uint32_t changes = tank.bandChanges;
+        uint64_t dueUs = now + CUS_T1_MS * 1000;
+        events.at(dueUs, [changes, dueUs]() { checkT1(changes, dueUs); });
+    } else if (reaction.pending) {
+        // 2 -> 1: the valve stays open, an open reaction is no longer owed
+        reactionStats[reaction.kind].aborted++;
+        reaction.pending = false;
+    }
+}
+
+// ==================== PHYSICS ====================
+
+const Scenario* scenario;
+
+void physicsStep() {
+    const double dt = PHYSICS_STEP_US / 1e6;
+    double valve = valveFraction();
+    double rain = scenario->rainCmPerS(nowUs() / 1e6);
+    double drain = tank.levelCm > 0 ? DRAIN_FULL_CM_S * valve * sqrt(tank.levelCm / DRAIN_REF_LEVEL_CM) : 0;
+
+    tank.levelCm += (rain - drain) * dt;
+    if (tank.levelCm < 0) {
+        tank.levelCm = 0;
+    }
+    if (tank.levelCm >= TANK_HEIGHT_CM) {
+        tank.spilledCm += tank.levelCm - TANK_HEIGHT_CM;
+        tank.levelCm = TANK_HEIGHT_CM;
+        if (!tank.overflowing) {
+            tank.overflowing = true;
+            tank.overflowEvents++;
+        }
+        tank.overflowUs += PHYSICS_STEP_US;
+    } else if (tank.levelCm < TANK_HEIGHT_CM - 0.1) {
+        tank.overflowing = false;
+    }
+    if (tank.levelCm > tank.peakCm) {
+        tank.peakCm = tank.levelCm;
+    }
+    if (tank.band == 2) {
+        tank.aboveL2Us += PHYSICS_STEP_US;
+    }
+    tank.valveIntegral += valve * dt;
+
+    int band = tms::levelBand(levelUnits(tank.levelCm));
+    if (band != tank.band) {
+        onBandChange(tank.band, band);
+    }
+    events.at(nowUs() + PHYSICS_STEP_US, physicsStep);
+}
+
+// ==================== BROKER ====================
+
+struct MqttMessage {
+    bool alert;
+    int32_t level;
+};
+
+struct Broker {
+    uint64_t lastArrivalUs;
+    uint32_t published;
+    uint32_t dropped;
+    uint64_t bytes;
+};
+
+Broker broker = {};
+
+void cusOnMqtt(const MqttMessage& message);
+
+/**
+ * QoS 0 publish: delivered in order after the network latency, or lost
+ */
+void brokerPublish(const MqttMessage& message, size_t bytes) {
+    broker.published++;
+    broker.bytes += bytes;
+    if (chance(options.brokerLoss)) {
+        broker.dropped++;
+        return;
+    }
+    uint64_t arrival = nowUs() + delayUs(options.brokerLatencyMs, options.brokerJitterMs);
+    if (arrival < broker.lastArrivalUs) {
+        arrival = broker.lastArrivalUs;
+    }
+    broker.lastArrivalUs = arrival;
+    events.at(arrival, [message]() { cusOnMqtt(message); });
+}
+
+// ==================== TMS ====================
+
+struct TmsSample {
+    int32_t level;
+};
+
+struct TmsNode {
+    tms::EchoConversion conversion;
+    tms::AdaptiveSampler sampler;
+    tms::AlarmEngine alarms;
+    tms::PublishPolicy policy;
+    std::vector<tms::AlarmEvent> alertQueue;  // sonarTask -> mqttTask
+    std::vector<TmsSample> sampleQueue;
+    WakeableTask mqttTask;
+    uint64_t lastWakeUs;                      // vTaskDelayUntil grid
+    uint32_t samples;
+    uint32_t alertsSent;
+    uint32_t levelsSent;
+};
+
+TmsNode tmsNode = {};
+std::normal_distribution<double> sonarNoise;
+
+void tmsMqttTask();
+
+/**
+ * sonarTask: one acquisition, then sleep for the adaptive period
+ */
+void tmsSonarTask() {
+    TmsNode& node = tmsNode;
+    double cm = tank.levelCm + (options.noiseCm > 0 ? sonarNoise(rng) : 0);
+    uint32_t echoNs = cm > 0 ? (uint32_t)(cm * 2e9 / node.conversion.speedCmPerS + 0.5) : 0;
+    int32_t level = tms::echoToLevel(node.conversion, echoNs);
+
+    if (level > 0) {
+        node.samples++;
+        onSensed(level);
+
+        tms::AlarmEvent alert;
+        bool alerted = tms::ALARM_ENGINE_ENABLED &&
+                       tms::evaluateAlarm(node.alarms, level, nowMs(), nowUs(), alert);
+        if (alerted) {
+            node.alertQueue.push_back(alert);
+        }
+        if (tms::ADAPTIVE_SAMPLING_ENABLED) {
+            tms::nextSamplingPeriod(node.sampler, level, nowUs());
+        }
+        node.sampleQueue.push_back({ level });
+        if (alerted) {
+            wakeAt(node.mqttTask, nowUs(), tmsMqttTask);
+        }
+    }
+
+    node.lastWakeUs += (uint64_t)node.sampler.periodMs * 1000;
+    events.at(node.lastWakeUs, tmsSonarTask);
+}
+
+/**
+ * mqttTask (connected): alerts first, then the samples the publish policy lets through
+ */
+void tmsMqttTask() {
+    TmsNode& node = tmsNode;
+    char payload[128];
+
+    for (const tms::AlarmEvent& alert : node.alertQueue) {
+        int length = tms::formatAlert(payload, sizeof(payload), alert, nowUs());
+        brokerPublish({ true, alert.level }, strlen(tms::MQTT_TOPIC_ALERT) + length);
+        node.alertsSent++;
+    }
+    node.alertQueue.clear();
+
+    for (const TmsSample& sample : node.sampleQueue) {
+        if (tms::evaluatePublish(node.policy, sample.level, nowMs()) == tms::PUBLISH_NONE) {
+            continue;
+        }
+        int length = tms::formatLevel(payload, sizeof(payload), sample.level);
+        brokerPublish({ false, sample.level }, strlen(tms::MQTT_TOPIC_LEVEL) + length);
+        node.levelsSent++;
+    }
+    node.sampleQueue.clear();
+
+    wakeAt(node.mqttTask, nowUs() + TMS_MQTT_POLL_MS * 1000, tmsMqttTask);
+}
+
+void startTms() {
+    TmsNode& node = tmsNode;
+    tms::setEchoTemperature(node.conversion, tms::AMBIENT_TEMPERATURE_DECI_C);
+    tms::setupAdaptiveSampler(node.sampler);
+    node.lastWakeUs = nowUs();
+    events.at(nowUs(), tmsSonarTask);
+    wakeAt(node.mqttTask, nowUs(), tmsMqttTask);
+}
+
+// ==================== SERIAL LINE ====================
+
+/**
+ * One direction of the UART between the CUS and the WCS
+ */
+struct SerialLine {
+    uint64_t busyUntilUs;
+    uint64_t lastArrivalUs;
+    uint32_t messages;
+    uint32_t dropped;   // Corrupted on the wire (loss)
+    uint32_t garbled;   // Sent at another baud rate than the receiver's
+    uint64_t bytes;
+};
+
+SerialLine downlink = {};  // CUS -> WCS
+SerialLine uplink = {};    // WCS -> CUS
+
+typedef void (*SerialReceiver)(const std::vector<uint8_t>& data, unsigned long baud);
+
+/**
+ * Put one message on a line: it follows the previous one at the sender's
+ * baud rate (10 bits per byte) and arrives after the adapter latency.
+ * A lost message still occupies the line
+ */
+void serialSend(SerialLine& line, const std::vector<uint8_t>& data, unsigned long baud, SerialReceiver receiver) {
+    uint64_t start = nowUs() > line.busyUntilUs ? nowUs() : line.busyUntilUs;
+    line.busyUntilUs = start + (uint64_t)data.size() * 10000000ULL / baud;
+    line.messages++;
+    line.bytes += data.size();
+    if (chance(options.serialLoss)) {
+        line.dropped++;
+        return;
+    }
+    uint64_t arrival = line.busyUntilUs + delayUs(options.serialLatencyMs, options.serialJitterMs);
+    if (arrival < line.lastArrivalUs) {
+        arrival = line.lastArrivalUs;
+    }
+    line.lastArrivalUs = arrival;
+    events.at(arrival, [data, baud, receiver]() { receiver(data, baud); });
+}
+
+/**
+ * CUS -> WCS: into the sketch's RX buffer
+ */
+void wcsReceive(const std::vector<uint8_t>& data, unsigned long baud) {
+    if (baud != sim::board().uart.baud) {
+        downlink.garbled++;
+        return;
+    }
+    sim::board().uart.inject(std::string(data.begin(), data.end()));
+}
+
+void cusReceive(const std::vector<uint8_t>& data, unsigned long baud);
+
+std::vector<uint8_t> wcsTxMessage;
+
+/**
+ * Serial TX hook of the sketch: one message per line or frame delimiter,
+ * sent at the baud rate in force when it was written
+ */
+void onWcsTx(const uint8_t* data, size_t length) {
+    uint8_t delimiter = linkProtocol == LINK_BINARY ? 0 : '\n';
+    for (size_t i = 0; i < length; i++) {
+        wcsTxMessage.push_back(data[i]);
+        if (data[i] == delimiter) {
+            serialSend(uplink, wcsTxMessage, sim::board().uart.baud, cusReceive);
+            wcsTxMessage.clear();
+        }
+    }
+}
+
+// ==================== CUS ====================
+
+enum CusMode {
+    CUS_UNCONNECTED,
+    CUS_AUTOMATIC,
+    CUS_MANUAL
+};
+
+struct PendingCommand {
+    uint16_t id;
+    bool valve;          // set_valve, otherwise set_mode
+    int value;           // Percentage or WCS mode code
+    uint64_t firstSentUs;
+    uint64_t lastSentUs;
+    int attempts;
+};
+
+struct CommandStats {
+    uint32_t sent;
+    uint32_t acked;
+    uint32_t nacked;
+    uint32_t failed;
+    uint32_t retries;
+    Distribution rttMs;
+};
+
+struct CusNode {
+    // SystemState
+    CusMode mode;
+    double levelCm;
+    uint64_t lastTmsUs;
+    bool tmsSeen;
+    int valveCommand;
+    bool wcsLocal;   // SystemState.isWcsLocalControl
+
+    // TankMonitor
+    WakeableTask monitor;
+    bool wasAboveL1;
+    uint64_t aboveL1SinceUs;
+
+    // SerialService
+    bool binaryLink;
+    unsigned long baud;
+    uint64_t lastHeartbeatUs;
+    uint64_t lastFrameUs;
+    uint64_t lastPolicySentUs;
+    bool policyDue;
+    uint8_t txSeq;
+    FrameAssembler frame;  // Same framing as LinkFrame.decode
+    int lastValveCommand;
+    int lastStatusSeq;
+    uint32_t lostStatus;
+    uint32_t rxErrors;
+
+    // CommandTracker
+    std::vector<PendingCommand> inFlight;
+    uint16_t nextId;
+    CommandStats commands;
+
+    // Messages sent by type
+    uint32_t sentHeartbeats;
+    uint32_t sentLevels;
+    uint32_t sentPolicies;
+    uint32_t receivedStatus;
+    uint32_t receivedReplies;
+    uint32_t receivedReports;
+};
+
+CusNode cus;
+
+void cusSend(const std::vector<uint8_t>& data) {
+    serialSend(downlink, data, cus.baud, wcsReceive);
+}
+
+void cusSendLine(const std::string& json) {
+    std::vector<uint8_t> data(json.begin(), json.end());
+    data.push_back('\n');
+    cusSend(data);
+}
+
+void cusSendFrame(uint8_t opcode, const uint8_t* payload, uint8_t length) {
+    uint8_t raw[FRAME_MAX_SIZE];
+    uint8_t encoded[FRAME_MAX_ENCODED];
+    raw[0] = opcode;
+    raw[1] = cus.txSeq++;
+    if (length > 0) {
+        memcpy(&raw[FRAME_HEADER_SIZE], payload, length);
+    }
+    uint8_t size = FRAME_HEADER_SIZE + length;
+    uint16_t crc = crc16(raw, size);
+    raw[size++] = crc & 0xFF;
+    raw[size++] = crc >> 8;
+
+    uint8_t encodedLength = cobsEncode(raw, size, encoded);
+    std::vector<uint8_t> data(encoded, encoded + encodedLength);
+    data.push_back(0);
+    cusSend(data);
+}
+
+// ---- CommandTracker + SerialService commands ----
+
+void cusTransmit(PendingCommand& command) {
+    if (cus.binaryLink) {
+        uint8_t payload[3] = { (uint8_t)command.value, (uint8_t)(command.id & 0xFF), (uint8_t)(command.id >> 8) };
+        cusSendFrame(command.valve ? OP_SET_VALVE : OP_SET_MODE, payload, sizeof(payload));
+    } else if (command.valve) {
+        cusSendLine("{\"cmd\":\"set_valve\",\"value\":" + std::to_string(command.value) +
+                    ",\"id\":" + std::to_string(command.id) + "}");
+    } else {
+        cusSendLine(std::string("{\"cmd\":\"set_mode\",\"value\":\"") +
+                    (command.value == MODE_MANUAL ? "MANUAL" : "AUTOMATIC") +
+                    "\",\"id\":" + std::to_string(command.id) + "}");
+    }
+    command.lastSentUs = nowUs();
+    command.attempts++;
+    if (command.attempts > 1) {
+        cus.commands.retries++;
+    }
+}
+
+/**
+ * New command replacing an in-flight one of the same type, unless it is the same
+ */
+void cusCommand(bool valve, int value) {
+    for (size_t i = 0; i < cus.inFlight.size(); i++) {
+        if (cus.inFlight[i].valve == valve) {
+            if (cus.inFlight[i].value == value) {
+                return;
+            }
+            cus.inFlight.erase(cus.inFlight.begin() + i);
+            break;
+        }
+    }
+    PendingCommand command = { cus.nextId, valve, value, nowUs(), 0, 0 };
+    cus.nextId = cus.nextId % 0xFFFF + 1;
+    cus.commands.sent++;
+    cusTransmit(command);
+    cus.inFlight.push_back(command);
+}
+
+void cusRetryCommands() {
+    for (size_t i = 0; i < cus.inFlight.size();) {
+        PendingCommand& command = cus.inFlight[i];
+        if (command.lastSentUs != 0 && nowUs() - command.lastSentUs < COMMAND_TIMEOUT_MS * 1000) {
+            i++;
+        } else if (command.attempts >= COMMAND_MAX_ATTEMPTS) {
+            cus.commands.failed++;
+            cus.inFlight.erase(cus.inFlight.begin() + i);
+        } else {
+            cusTransmit(command);
+            i++;
+        }
+    }
+}
+
+void cusCommandReply(uint16_t id, uint8_t result, int value) {
+    for (size_t i = 0; i < cus.inFlight.size(); i++) {
+        PendingCommand& command = cus.inFlight[i];
+        if (command.id != id) {
+            continue;
+        }
+        if (result == CMD_UNCONNECTED && command.attempts < COMMAND_MAX_ATTEMPTS) {
+            command.lastSentUs = 0;  // Due again on the next check
+            return;
+        }
+        if (result == CMD_OK) {
+            cus.commands.acked++;
+            cus.commands.rttMs.add((nowUs() - command.firstSentUs) / 1000.0);
+            if (command.valve) {
+                cus.valveCommand = value;
+            }
+        } else {
+            cus.commands.nacked++;
+        }
+        cus.inFlight.erase(cus.inFlight.begin() + i);
+        return;
+    }
+}
+
+// ---- SerialService ----
+
+void cusHeartbeat() {
+    cus.sentHeartbeats++;
+    if (cus.binaryLink) {
+        cusSendFrame(OP_PING, NULL, 0);
+    } else if (options.negotiate) {
+        cusSendLine("{\"cmd\":\"hello\",\"proto\":" + std::to_string(LINK_PROTOCOL_VERSION) +
+                    ",\"baud\":" + std::to_string(CUS_FAST_BAUD) + "}");
+    } else {
+        cusSendLine("{\"cmd\":\"ping\"}");
+    }
+}
+
+void cusSendPolicy() {
+    uint16_t l1 = (uint16_t)levelUnits(CUS_L1_CM);
+    uint16_t l2 = (uint16_t)levelUnits(CUS_L2_CM);
+    uint32_t t1 = (uint32_t)CUS_T1_MS;
+    cus.sentPolicies++;
+    if (cus.binaryLink) {
+        uint8_t payload[8] = {
+            (uint8_t)(l1 & 0xFF), (uint8_t)(l1 >> 8), (uint8_t)(l2 & 0xFF), (uint8_t)(l2 >> 8),
+            (uint8_t)(t1 & 0xFF), (uint8_t)(t1 >> 8), (uint8_t)(t1 >> 16), (uint8_t)(t1 >> 24)
+        };
+        cusSendFrame(OP_SET_POLICY, payload, sizeof(payload));
+        return;
+    }
+    cusSendLine("{\"cmd\":\"policy\",\"l1\":" + std::to_string(l1) + ",\"l2\":" + std::to_string(l2) +
+                ",\"t1\":" + std::to_string(t1) + "}");
+}
+
+void cusSendLevel(double levelCm) {
+    if (!options.localControl) {
+        return;
+    }
+    int32_t level = levelUnits(levelCm);
+    level = level < 0 ? 0 : (level > 0xFFFF ? 0xFFFF : level);
+    cus.sentLevels++;
+    if (cus.binaryLink) {
+        uint8_t payload[2] = { (uint8_t)(level & 0xFF), (uint8_t)(level >> 8) };
+        cusSendFrame(OP_LEVEL, payload, sizeof(payload));
+        return;
+    }
+    cusSendLine("{\"cmd\":\"level\",\"value\":" + std::to_string(level) + "}");
+}
+
+/**
+ * Checks of the SerialService loop, run after every read (or read timeout)
+ */
+void cusSerialChecks() {
+    uint64_t now = nowUs();
+    if (now - cus.lastHeartbeatUs >= HEARTBEAT_INTERVAL_MS * 1000) {
+        cusHeartbeat();
+        cus.lastHeartbeatUs = now;
+    }
+    if (cus.binaryLink && now - cus.lastFrameUs > LINK_TIMEOUT_MS * 1000) {
+        cus.binaryLink = false;
+        cus.baud = CUS_BAUD;
+        cus.policyDue = true;
+        cus.wcsLocal = false;
+    }
+    cusRetryCommands();
+    if (options.localControl && (cus.policyDue || now - cus.lastPolicySentUs >= POLICY_REFRESH_MS * 1000)) {
+        cusSendPolicy();
+        cus.lastPolicySentUs = now;
+        cus.policyDue = false;
+    }
+}
+
+void cusSerialLoop() {
+    cusSerialChecks();
+    events.at(nowUs() + SERIAL_READ_TIMEOUT_MS * 1000, cusSerialLoop);
+}
+
+void cusApplyStatus(int mode, int valve, int command, int seq) {
+    cus.receivedStatus++;
+    if (seq >= 0) {
+        if (cus.lastStatusSeq >= 0) {
+            int gap = (seq - cus.lastStatusSeq - 1) & 0xFFFF;
+            if (gap < 0x8000) {
+                cus.lostStatus += gap;
+            }
+        }
+        cus.lastStatusSeq = seq;
+    }
+    cus.wcsLocal = mode == MODE_LOCAL;
+    if (mode == MODE_AUTOMATIC || mode == MODE_LOCAL) {
+        cus.mode = CUS_AUTOMATIC;
+    } else if (mode == MODE_MANUAL) {
+        cus.mode = CUS_MANUAL;
+    } else {
+        cus.mode = CUS_UNCONNECTED;
+    }
+    if (command >= 0 && command != cus.lastValveCommand) {
+        cus.lastValveCommand = command;
+        cus.valveCommand = command;
+    }
+}
+
+int jsonInt(const char* line, const char* key, int fallback) {
+    const char* value = jsonValue(line, key);
+    return value != NULL ? atoi(value) : fallback;
+}
+
+void cusHandleLine(const char* line) {
+    if (jsonValue(line, "hello") != NULL && jsonInt(line, "hello", 0) == LINK_PROTOCOL_VERSION) {
+        cus.binaryLink = true;
+        cus.baud = (unsigned long)jsonInt(line, "baud", CUS_BAUD);
+        cus.lastFrameUs = nowUs();
+        cus.policyDue = true;
+        cusSendFrame(OP_PING, NULL, 0);
+        return;
+    }
+    if (jsonValue(line, "ack") != NULL || jsonValue(line, "nack") != NULL) {
+        cus.receivedReplies++;
+        bool ack = jsonValue(line, "ack") != NULL;
+        const char* reason = jsonValue(line, "reason");
+        uint8_t result = ack ? CMD_OK : jsonStringIs(reason, "unconnected") ? CMD_UNCONNECTED :
+                         jsonStringIs(reason, "bad_value") ? CMD_BAD_VALUE : CMD_UNKNOWN;
+        cusCommandReply((uint16_t)jsonInt(line, ack ? "ack" : "nack", 0), result, jsonInt(line, "value", 0));
+        return;
+    }
+    if (jsonValue(line, "sched") != NULL) {
+        cus.receivedReports++;
+        return;
+    }
+    const char* mode = jsonValue(line, "mode");
+    if (mode != NULL && jsonValue(line, "valve") != NULL) {
+        int code = jsonStringIs(mode, "AUTOMATIC") ? MODE_AUTOMATIC : jsonStringIs(mode, "MANUAL") ? MODE_MANUAL :
+                   jsonStringIs(mode, "LOCAL") ? MODE_LOCAL : MODE_UNCONNECTED;
+        cusApplyStatus(code, jsonInt(line, "valve", 0), jsonInt(line, "cmd", -1), jsonInt(line, "seq", -1));
+    }
+}
+
+void cusHandleFrame(const uint8_t* frame, uint8_t length) {
+    const uint8_t* payload = &frame[FRAME_HEADER_SIZE];
+    uint8_t payloadLength = length - FRAME_HEADER_SIZE;
+    cus.lastFrameUs = nowUs();
+
+    if (frame[0] == OP_STATUS && payloadLength >= 7) {
+        cusApplyStatus(payload[0], payload[1], payload[4], payload[5] | (payload[6] << 8));
+    } else if (frame[0] == OP_ACK && payloadLength >= 6) {
+        cus.receivedReplies++;
+        cusCommandReply(payload[0] | (payload[1] << 8), payload[2], payload[3]);
+    } else if (frame[0] == OP_SCHED) {
+        cus.receivedReports++;
+    }
+}
+
+/**
+ * WCS -> CUS: one line or frame
+ */
+void cusReceive(const std::vector<uint8_t>& data, unsigned long baud) {
+    if (baud != cus.baud) {
+        uplink.garbled++;
+        return;
+    }
+    if (cus.binaryLink) {
+        for (uint8_t c : data) {
+            uint8_t length = assembleFrame(cus.frame, c);
+            if (length > 0) {
+                cusHandleFrame(cus.frame.buffer, length);
+            }
+        }
+    } else if (!data.empty() && data[0] == '{') {
+        std::string line(data.begin(), data.end());
+        cusHandleLine(line.c_str());
+    }
+    cusSerialChecks();
+}
+
+// ---- TankMonitor ----
+
+bool cusTmsConnected() {
+    return cus.tmsSeen && nowUs() - cus.lastTmsUs < CUS_T2_MS * 1000;
+}
+
+int cusValveOpening(double level) {
+    if (level >= CUS_L2_CM) {
+        cus.wasAboveL1 = false;
+        return 100;
+    }
+    if (level <= CUS_L1_CM) {
+        cus.wasAboveL1 = false;
+        return 0;
+    }
+    if (!cus.wasAboveL1) {
+        cus.aboveL1SinceUs = nowUs();
+        cus.wasAboveL1 = true;
+    }
+    if (nowUs() - cus.aboveL1SinceUs >= CUS_T1_MS * 1000) {
+        return 50;
+    }
+    return cus.valveCommand;
+}
+
+void cusMonitorUpdate() {
+    if (!cusTmsConnected()) {
+        cus.mode = CUS_UNCONNECTED;
+    } else {
+        if (cus.mode == CUS_UNCONNECTED) {
+            cus.mode = CUS_AUTOMATIC;
+            cusCommand(false, MODE_AUTOMATIC);
+        }
+        if (cus.mode == CUS_AUTOMATIC) {
+            int target = cusValveOpening(cus.levelCm);
+            if (!cus.wcsLocal && target != cus.valveCommand) {
+                cusCommand(true, target);
+            }
+        }
+    }
+    wakeAt(cus.monitor, nowUs() + MONITOR_INTERVAL_MS * 1000, cusMonitorUpdate);
+}
+
+// ---- MQTTService ----
+
+void cusOnMqtt(const MqttMessage& message) {
+    if (message.alert && !options.alerts) {
+        return;
+    }
+    cus.levelCm = (double)message.level / tms::LEVEL_UNITS_PER_CM;
+    cus.lastTmsUs = nowUs();
+    cus.tmsSeen = true;
+    onCusLevel(cus.levelCm);
+    cusSendLevel(cus.levelCm);
+    if (cus.mode == CUS_UNCONNECTED) {
+        cus.mode = CUS_AUTOMATIC;
+    }
+    if (message.alert) {
+        wakeAt(cus.monitor, nowUs(), cusMonitorUpdate);  // TankMonitor.requestUpdate
+    }
+}
+
+void startCus() {
+    cus.baud = CUS_BAUD;
+    cus.nextId = 1;
+    cus.lastValveCommand = -1;
+    cus.lastStatusSeq = -1;
+    cus.policyDue = true;
+    cus.lastHeartbeatUs = nowUs();
+    events.at(nowUs(), cusSerialLoop);
+    wakeAt(cus.monitor, nowUs(), cusMonitorUpdate);
+}
+
+// ==================== REPORT ====================
+
+/**
+ * Flat list of results, printed aligned or as one JSON object
+ */
+struct Report {
+    std::vector<std::pair<std::string, std::string>> fields;
+
+    void add(const std::string& key, const std::string& value, bool quoted) {
+        fields.push_back({ key, quoted ? "\"" + value + "\"" : value });
+    }
+
+    void add(const std::string& key, uint64_t value) {
+        add(key, std::to_string(value), false);
+    }
+
+    void add(const std::string& key, double value, int decimals) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.*f", decimals, value);
+        add(key, text, false);
+    }
+
+    void addDistribution(const std::string& key, const Distribution& values) {
+        add(key + "_p50_ms", values.percentile(50), 1);
+        add(key + "_p90_ms", values.percentile(90), 1);
+        add(key + "_p99_ms", values.percentile(99), 1);
+        add(key + "_max_ms", values.percentile(100), 1);
+    }
+
+    void print() const {
+        if (options.json) {
+            printf("{");
+            for (size_t i = 0; i < fields.size(); i++) {
+                printf("%s\"%s\":%s", i > 0 ? "," : "", fields[i].first.c_str(), fields[i].second.c_str());
+            }
+            printf("}\n");
+            return;
+        }
+        for (const auto& field : fields) {
+            printf("  %-26s %s\n", field.first.c_str(), field.second.c_str());
+        }
+        printf("\n");
+    }
+};
+
+void printReport(double durationS) {
+    Report report;
+    report.add("scenario", scenario->name, true);
+    report.add("duration_s", durationS, 0);
+    report.add("seed", (uint64_t)options.seed);
+    report.add("link", linkProtocol == LINK_BINARY ? "binary" : "json", true);
+    report.add("link_baud", (uint64_t)sim::board().uart.baud);
+
+    report.add("level_peak_cm", tank.peakCm, 2);
+    report.add("overflow_events", (uint64_t)tank.overflowEvents);
+    report.add("overflow_s", tank.overflowUs / 1e6, 1);
+    report.add("overflow_spill_cm", tank.spilledCm, 2);
+    report.add("above_l2_s", tank.aboveL2Us / 1e6, 1);
+    report.add("valve_mean_pct", 100 * tank.valveIntegral / durationS, 1);
+
+    for (int kind = 0; kind < REACTION_KIND_COUNT; kind++) {
+        const ReactionStats& stats = reactionStats[kind];
+        std::string name = REACTION_NAMES[kind];
+        report.add(name + "_n", (uint64_t)stats.totalMs.values.size());
+        report.add(name + "_aborted", (uint64_t)stats.aborted);
+        report.addDistribution(name, stats.totalMs);
+        if (kind != REACTION_T1_HALF) {
+            report.add(name + "_sense_p50_ms", stats.senseMs.percentile(50), 1);
+            report.add(name + "_network_p50_ms", stats.networkMs.percentile(50), 1);
+            report.add(name + "_actuation_p50_ms", stats.actuationMs.percentile(50), 1);
+        }
+    }
+
+    report.add("tms_samples", (uint64_t)tmsNode.samples);
+    report.add("mqtt_level", (uint64_t)tmsNode.levelsSent);
+    report.add("mqtt_alert", (uint64_t)tmsNode.alertsSent);
+    report.add("mqtt_suppressed", (uint64_t)tmsNode.policy.suppressed);
+    report.add("mqtt_dropped", (uint64_t)broker.dropped);
+    report.add("mqtt_bytes", broker.bytes);
+
+    report.add("serial_down_msgs", (uint64_t)downlink.messages);
+    report.add("serial_down_bytes", downlink.bytes);
+    report.add("serial_down_lost", (uint64_t)(downlink.dropped + downlink.garbled));
+    report.add("serial_up_msgs", (uint64_t)uplink.messages);
+    report.add("serial_up_bytes", uplink.bytes);
+    report.add("serial_up_lost", (uint64_t)(uplink.dropped + uplink.garbled));
+    report.add("cus_heartbeats", (uint64_t)cus.sentHeartbeats);
+    report.add("cus_level_forwards", (uint64_t)cus.sentLevels);
+    report.add("cus_policies", (uint64_t)cus.sentPolicies);
+    report.add("wcs_status", (uint64_t)cus.receivedStatus);
+    report.add("wcs_status_lost", (uint64_t)cus.lostStatus);
+    report.add("wcs_replies", (uint64_t)cus.receivedReplies);
+    report.add("wcs_reports", (uint64_t)cus.receivedReports);
+    report.add("wcs_rx_errors", (uint64_t)serialRxErrors());
+
+    const CommandStats& commands = cus.commands;
+    report.add("cmd_sent", (uint64_t)commands.sent);
+    report.add("cmd_acked", (uint64_t)commands.acked);
+    report.add("cmd_nacked", (uint64_t)commands.nacked);
+    report.add("cmd_failed", (uint64_t)commands.failed);
+    report.add("cmd_retries", (uint64_t)commands.retries);
+    report.addDistribution("cmd_rtt", commands.rttMs);
+
+    if (!options.json) {
+        printf("=== %s: %s ===\n", scenario->name, scenario->description);
+    }
+    report.print();
+}
+
+// ==================== SCENARIO RUN ====================
+
+/**
+ * Boot the WCS sketch, then run every node until the scenario ends
+ */
+void runScenario(const Scenario& selected) {
+    scenario = &selected;
+    rng.seed(options.seed);
+    sonarNoise = std::normal_distribution<double>(0, options.noiseCm > 0 ? options.noiseCm : 1);
+
+    sim::Board& board = sim::board();
+    board.clock.setVirtual(true, 0);
+    board.uart.onTx = onWcsTx;
+    setup();
+    events.advance(board.clock.micros());
+
+    tank.levelCm = START_LEVEL_CM;
+    tank.peakCm = START_LEVEL_CM;
+    tank.band = tms::levelBand(levelUnits(START_LEVEL_CM));
+    uint64_t startUs = nowUs();
+    uint64_t endUs = startUs + (uint64_t)(options.durationS * 1e6);
+
+    events.at(startUs, physicsStep);
+    startTms();
+    startCus();
+
+    // loop() passes back to back, interleaved with the other events
+    uint64_t nextPassUs = startUs;
+    while (nextPassUs < endUs) {
+        if (events.nextUs() <= nextPassUs) {
+            events.runNext();
+            continue;
+        }
+        events.advance(nextPassUs);
+        loop();
+        checkReaction();
+        nextPassUs += options.wcsPassUs;
+    }
+
+    printReport(options.durationS);
+}
+
+// ==================== COMMAND LINE ====================
+
+void printUsage() {
+    printf("Usage: system_sim [options]\n"
+           "  --scenario NAME        all (default)");
+    for (int i = 0; i < SCENARIO_COUNT; i++) {
+        printf(", %s", SCENARIOS[i].name);
+    }
+    printf("\n"
+           "  --duration S           simulated time per scenario (3600)\n"
+           "  --seed N               random seed (1)\n"
+           "  --broker-latency MS    TMS to CUS publish latency (20)\n"
+           "  --broker-jitter MS     extra uniform latency (10)\n"
+           "  --broker-loss P        publish loss probability (0)\n"
+           "  --serial-latency MS    USB-serial latency, each way (2)\n"
+           "  --serial-jitter MS     extra uniform latency (1)\n"
+           "  --serial-loss P        message corruption probability (0)\n"
+           "  --json-link            no binary negotiation (serial.protocol=json)\n"
+           "  --no-local             no local control on the WCS (control.local=false)\n"
+           "  --no-alerts            CUS ignores the TMS edge alerts\n"
+           "  --wcs-pass-us US       WCS loop() pass duration (500)\n"
+           "  --noise CM             sonar noise standard deviation (0)\n"
+           "  --json                 one JSON object per scenario\n");
+}
+
+bool parseOptions(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--json-link") {
+            options.negotiate = false;
+        } else if (arg == "--no-local") {
+            options.localControl = false;
+        } else if (arg == "--no-alerts") {
+            options.alerts = false;
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--scenario" && hasValue) {
+            options.scenario = argv[++i];
+        } else if (arg == "--duration" && hasValue) {
+            options.durationS = atof(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--broker-latency" && hasValue) {
+            options.brokerLatencyMs = atof(argv[++i]);
+        } else if (arg == "--broker-jitter" && hasValue) {
+            options.brokerJitterMs = atof(argv[++i]);
+        } else if (arg == "--broker-loss" && hasValue) {
+            options.brokerLoss = atof(argv[++i]);
+        } else if (arg == "--serial-latency" && hasValue) {
+            options.serialLatencyMs = atof(argv[++i]);
+        } else if (arg == "--serial-jitter" && hasValue) {
+            options.serialJitterMs = atof(argv[++i]);
+        } else if (arg == "--serial-loss" && hasValue) {
+            options.serialLoss = atof(argv[++i]);
+        } else if (arg == "--wcs-pass-us" && hasValue) {
+            options.wcsPassUs = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (arg == "--noise" && hasValue) {
+            options.noiseCm = atof(argv[++i]);
+        } else {
+            printUsage();
+            return false;
+        }
+    }
+    if (options.durationS <= 0 || options.wcsPassUs == 0) {
+        printUsage();
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (!parseOptions(argc, argv)) {
+        return 1;
+    }
+
+    int runs = 0;
+    int failures = 0;
+    for (int i = 0; i < SCENARIO_COUNT; i++) {
+        if (options.scenario != "all" && options.scenario != SCENARIOS[i].name) {
+            continue;
+        }
+        runs++;
+
+        // The sketch keeps its state in globals: boot it in a fresh process
+        fflush(stdout);
+        pid_t child = fork();
+        if (child == 0) {
+            runScenario(SCENARIOS[i]);
+            fflush(stdout);
+            _exit(0);
+        }
+        int status = 0;
+        if (child < 0 || waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "scenario %s failed\n", SCENARIOS[i].name);
+            failures++;
+        }
+    }
+
+    if (runs == 0) {
+        printUsage();
+        return 1;
+    }
+    return failures > 0 ? 1 : 0;
+}
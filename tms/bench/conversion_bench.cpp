@@ -0,0 +1,87 @@
+/**
+ * TMS Conversion Benchmark (host)
+ * Compares the former float echo conversion (readSonarDistance) and the
+ * "%.2f" payload formatting of mqttTask with the fixed-point path of
+ * task/Level.h; the agreement at 20 C is checked on stderr.
+ * Run with: pio run -e bench -t exec
+ * or: g++ -std=gnu++17 -O2 -DNATIVE_BUILD -I../hal/native -Isrc bench/conversion_bench.cpp
+ * Options (--json, --out, --baseline, ...): see hal/native/SimBench.h
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <SimBench.h>
+#include "task/Level.h"
+
+// ==================== LEGACY PATH ====================
+
+/**
+ * echoToDistanceCm as it was before the fixed-point conversion
+ */
+float legacyEchoToDistanceCm(float duration) {
+    float distance = (duration * 0.0343f) / 2.0f;
+    if (duration == 0 || distance > 400) {
+        return 0.0;
+    }
+    return distance;
+}
+
+// ==================== BENCHMARK ====================
+
+const int ECHO_COUNT = 4096;
+
+uint32_t echoes[ECHO_COUNT];
+EchoConversion conversion;
+char text[16];
+
+/**
+ * Next echo of the set, one per call
+ */
+uint32_t nextEcho() {
+    static int index = 0;
+    uint32_t echoNs = echoes[index];
+    index = (index + 1) % ECHO_COUNT;
+    return echoNs;
+}
+
+void registerBenchmarks() {
+    sim::benchRegister("convert/float", [] {
+        sim::benchKeep(legacyEchoToDistanceCm(nextEcho() / 1000.0f));
+    });
+    sim::benchRegister("convert/fixed", [] {
+        sim::benchKeep(echoToLevel(conversion, nextEcho()));
+    });
+    sim::benchRegister("format/float", [] {
+        sim::benchKeep(snprintf(text, sizeof(text), "%.2f", legacyEchoToDistanceCm(nextEcho() / 1000.0f)));
+    });
+    sim::benchRegister("format/fixed", [] {
+        sim::benchKeep(formatLevel(text, sizeof(text), echoToLevel(conversion, nextEcho())));
+    });
+}
+
+int main(int argc, char** argv) {
+    // Echoes spread over 2 .. 400 cm
+    srand(1);
+    for (int i = 0; i < ECHO_COUNT; i++) {
+        echoes[i] = 116000 + (uint32_t)(rand() % 23200000);
+    }
+    setEchoTemperature(conversion, 200);
+
+    // Agreement at 20 C (343.2 m/s vs the former fixed 343 m/s)
+    int32_t maxDiff = 0;
+    for (int i = 0; i < ECHO_COUNT; i++) {
+        int32_t legacy = levelFromCm(legacyEchoToDistanceCm(echoes[i] / 1000.0f));
+        int32_t diff = abs(echoToLevel(conversion, echoes[i]) - legacy);
+        if (diff > maxDiff) {
+            maxDiff = diff;
+        }
+    }
+    fprintf(stderr, "max difference at 20 C: %ld units (0.1 mm)\n", (long)maxDiff);
+    for (int16_t t = -200; t <= 400; t += 200) {
+        fprintf(stderr, "speed of sound at %d.%d C: %lu cm/s\n", t / 10, abs(t % 10),
+                (unsigned long)speedOfSoundCmPerS(t));
+    }
+
+    registerBenchmarks();
+    return sim::benchMain(argc, argv, "tms");
+}
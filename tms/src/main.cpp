@@ -31,6 +31,12 @@ TaskHandle_t ledTaskHandle = NULL;
 // ==================== SETUP ====================
 void setup() {
     Serial.begin(115200);
+    
+    if (POWER_MODE == POWER_DEEP_SLEEP) {
+        // No tasks in this mode: sample, maybe publish, sleep (does not return)
+        setupPins();
+        deepSleepCycle();
+    }
     delay(1000);
     
     Serial.println("\n=== TMS - Tank Monitoring Subsystem ===");
@@ -38,6 +44,7 @@ void setup() {
     
     // Initialize hardware pins
     setupPins();
+    setupPowerMode();
     
     // Create FreeRTOS Tasks
     createTasks();
@@ -51,3 +58,12 @@ void loop() {
     // Empty - all work done in FreeRTOS tasks
     vTaskDelay(pdMS_TO_TICKS(1000));
 }
+
+#ifdef NATIVE_BUILD
+// ==================== NATIVE ENTRY POINT ====================
+#include <SimMain.h>
+
+int main() {
+    return sim::run(setup, loop);
+}
+#endif
@@ -0,0 +1,82 @@
+/**
+ * TMS Adaptive Sampler
+ * Chooses the sonar sampling period from the level dynamics:
+ * fast when the level moves quickly or is close to L1/L2, slow when stable
+ */
+
+#ifndef TMS_ADAPTIVE_SAMPLER_H
+#define TMS_ADAPTIVE_SAMPLER_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "Level.h"
+
+// ==================== SAMPLER STATE ====================
+
+struct AdaptiveSampler {
+    bool hasLast;
+    int32_t lastLevel;
+    uint64_t lastCaptureUs;
+    int32_t rateUnitsPerS;  // Smoothed absolute rate of change (level units/s)
+    uint32_t periodMs;      // Current effective sampling period
+};
+
+// Q8 fixed-point versions of the float settings
+const int32_t SAMPLING_RATE_SMOOTHING_Q8 = (int32_t)(SAMPLING_RATE_SMOOTHING * 256 + 0.5f);
+const uint32_t SAMPLING_BACKOFF_Q8 = (uint32_t)(SAMPLING_BACKOFF_FACTOR * 256 + 0.5f);
+
+// ==================== SAMPLER FUNCTIONS ====================
+
+void setupAdaptiveSampler(AdaptiveSampler& sampler) {
+    sampler.hasLast = false;
+    sampler.rateUnitsPerS = 0;
+    sampler.periodMs = SAMPLING_FREQUENCY_MS;
+}
+
+/**
+ * Update the sampler with a new valid sample and compute the next period
+ * - rate term: keep the level change between samples near SAMPLING_TARGET_STEP_CM
+ * - proximity term: scale down linearly within SAMPLING_NEAR_THRESHOLD_CM of L1/L2
+ * The period shrinks immediately but grows by at most SAMPLING_BACKOFF_FACTOR per sample
+ * @return Next sampling period in ms
+ */
+uint32_t nextSamplingPeriod(AdaptiveSampler& sampler, int32_t level, uint64_t captureUs) {
+    if (sampler.hasLast && captureUs > sampler.lastCaptureUs) {
+        uint64_t dtUs = captureUs - sampler.lastCaptureUs;
+        int32_t rate = (int32_t)((uint64_t)abs(level - sampler.lastLevel) * 1000000ULL / dtUs);
+        sampler.rateUnitsPerS += (int32_t)((int64_t)SAMPLING_RATE_SMOOTHING_Q8 * (rate - sampler.rateUnitsPerS) / 256);
+    }
+    sampler.hasLast = true;
+    sampler.lastLevel = level;
+    sampler.lastCaptureUs = captureUs;
+    
+    uint32_t target = SAMPLING_MAX_PERIOD_MS;
+    
+    if (sampler.rateUnitsPerS > 0) {
+        uint32_t byRate = (uint32_t)((int64_t)SAMPLING_TARGET_STEP_UNITS * 1000 / sampler.rateUnitsPerS);
+        if (byRate < target) {
+            target = byRate;
+        }
+    }
+    
+    int32_t marginL1 = abs(level - LEVEL_L1_UNITS);
+    int32_t marginL2 = abs(level - LEVEL_L2_UNITS);
+    int32_t margin = marginL1 < marginL2 ? marginL1 : marginL2;
+    if (margin < SAMPLING_NEAR_THRESHOLD_UNITS) {
+        uint32_t byProximity = SAMPLING_MIN_PERIOD_MS +
+            (uint32_t)((int64_t)(SAMPLING_MAX_PERIOD_MS - SAMPLING_MIN_PERIOD_MS) * margin / SAMPLING_NEAR_THRESHOLD_UNITS);
+        if (byProximity < target) {
+            target = byProximity;
+        }
+    }
+    
+    uint32_t grown = (uint32_t)(((uint64_t)sampler.periodMs * SAMPLING_BACKOFF_Q8) >> 8);
+    if (target > grown) {
+        target = grown;
+    }
+    
+    sampler.periodMs = constrain(target, SAMPLING_MIN_PERIOD_MS, SAMPLING_MAX_PERIOD_MS);
+    return sampler.periodMs;
+}
+
+#endif // TMS_ADAPTIVE_SAMPLER_H
@@ -0,0 +1,118 @@
+/**
+ * TMS Edge Alarm Engine
+ * Evaluates the CUS L1/L2/T1 valve policy on-device right after each sample.
+ * Every state change becomes an alert that mqttTask publishes on
+ * MQTT_TOPIC_ALERT before any queued level sample, so the CUS can react
+ * to critical levels without waiting for the regular stream.
+ */
+
+#ifndef TMS_ALARM_ENGINE_H
+#define TMS_ALARM_ENGINE_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "Level.h"
+
+// ==================== ALARM STATE ====================
+
+/**
+ * Same states as TankMonitor.calculateValveOpening in the CUS
+ */
+enum AlarmState {
+    ALARM_NORMAL,      // level <= L1: valve closed
+    ALARM_ABOVE_L1,    // L1 < level < L2 for less than T1: valve unchanged
+    ALARM_L1_TIMEOUT,  // L1 < level < L2 for T1 or more: valve 50%
+    ALARM_CRITICAL     // level >= L2: valve 100%
+};
+
+struct AlarmEvent {
+    uint32_t seq;
+    AlarmState state;
+    AlarmState previous;
+    int32_t level;         // Level units
+    uint64_t captureUs;    // Time of the sample that raised the alert
+};
+
+struct AlarmEngine {
+    bool initialized;
+    AlarmState state;
+    unsigned long aboveL1SinceMs;
+    uint32_t seq;
+};
+
+const char* alarmStateName(AlarmState state) {
+    switch (state) {
+        case ALARM_ABOVE_L1: return "ABOVE_L1";
+        case ALARM_L1_TIMEOUT: return "L1_TIMEOUT";
+        case ALARM_CRITICAL: return "CRITICAL";
+        default: return "NORMAL";
+    }
+}
+
+/**
+ * Valve opening the CUS policy applies in a state
+ * @return Percentage, or -1 if the valve is left as is
+ */
+int alarmValveOpening(AlarmState state) {
+    switch (state) {
+        case ALARM_CRITICAL: return 100;
+        case ALARM_L1_TIMEOUT: return 50;
+        case ALARM_ABOVE_L1: return -1;
+        default: return 0;
+    }
+}
+
+// ==================== EVALUATION ====================
+
+/**
+ * Run the L1/L2/T1 rules on a new sample
+ * The first sample always raises an alert so the CUS learns the initial state
+ * @param event Filled in when the state changed
+ * @return true if an alert was raised
+ */
+bool evaluateAlarm(AlarmEngine& engine, int32_t level, unsigned long nowMs, uint64_t captureUs, AlarmEvent& event) {
+    AlarmState next;
+    if (level >= LEVEL_L2_UNITS) {
+        next = ALARM_CRITICAL;
+    } else if (level <= LEVEL_L1_UNITS) {
+        next = ALARM_NORMAL;
+    } else {
+        bool wasAboveL1 = engine.initialized &&
+                          (engine.state == ALARM_ABOVE_L1 || engine.state == ALARM_L1_TIMEOUT);
+        if (!wasAboveL1) {
+            engine.aboveL1SinceMs = nowMs;
+        }
+        next = (nowMs - engine.aboveL1SinceMs >= LEVEL_T1_MS) ? ALARM_L1_TIMEOUT : ALARM_ABOVE_L1;
+    }
+
+    if (engine.initialized && next == engine.state) {
+        return false;
+    }
+
+    event.seq = engine.seq++;
+    event.state = next;
+    event.previous = engine.initialized ? engine.state : next;
+    event.level = level;
+    event.captureUs = captureUs;
+
+    engine.initialized = true;
+    engine.state = next;
+    return true;
+}
+
+/**
+ * Alert payload: {"seq":..,"state":"..","prev":"..","level":..,"valve":..,"age_ms":..}
+ * age_ms is the time from the sample to the publish, so delayed alerts can be recognised
+ * @return Payload length (>= size means it did not fit)
+ */
+int formatAlert(char* payload, int size, const AlarmEvent& event, uint64_t nowUs) {
+    char level[16];
+    formatLevel(level, sizeof(level), event.level);
+    return snprintf(payload, size,
+                    "{\"seq\":%lu,\"state\":\"%s\",\"prev\":\"%s\",\"level\":%s,\"valve\":%d,\"age_ms\":%lu}",
+                    (unsigned long)event.seq, alarmStateName(event.state), alarmStateName(event.previous),
+                    level, alarmValveOpening(event.state),
+                    (unsigned long)((nowUs - event.captureUs) / 1000));
+}
+
+#endif // TMS_ALARM_ENGINE_H
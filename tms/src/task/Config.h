@@ -14,6 +14,11 @@ const char* WIFI_PASSWORD = "65363331";
 const char* MQTT_BROKER = "192.168.0.101";  // Change to your MQTT broker IP
 const int MQTT_PORT = 1883;
 const char* MQTT_TOPIC_LEVEL = "tank/level";
+const char* MQTT_TOPIC_BACKFILL = "tank/level/backfill";  // Samples buffered during outages
+const char* MQTT_TOPIC_BINARY = "tank/level/bin";          // Batched binary telemetry (Telemetry.h)
+const char* MQTT_TOPIC_DIAG = "tank/1/diag";               // tank/<DEVICE_ID>/diag
+const char* MQTT_TOPIC_ALERT = "tank/1/alert";             // Edge alarm state changes (retained)
+const uint16_t MQTT_BUFFER_SIZE = 1024;                    // Fits a full backfill batch
 const char* MQTT_CLIENT_ID = "TMS_ESP32";
 
 // ==================== HARDWARE PIN CONFIGURATION ====================
@@ -22,8 +27,113 @@ const int SONAR_ECHO_PIN = 12;
 const int LED_GREEN_PIN = 2;  // Network OK
 const int LED_RED_PIN = 4;    // Network Error
 
+// ==================== SONAR CHANNELS ====================
+/**
+ * One row per sonar. Channels of the same acoustic group (same tank or
+ * overlapping beams) fire one at a time with a guard interval in between;
+ * channels of different groups fire together.
+ * Channel 0 is the tank the CUS controls: it drives the alarms, the adaptive
+ * period, the offline buffer and the binary telemetry. The other channels
+ * publish live only, on their own topic.
+ */
+struct SonarChannelConfig {
+    int trigPin;
+    int echoPin;
+    int group;
+    const char* topic;
+};
+
+const SonarChannelConfig SONAR_CHANNELS[] = {
+    { SONAR_TRIG_PIN, SONAR_ECHO_PIN, 0, MQTT_TOPIC_LEVEL },
+    // { 14, 15, 1, "tank/2/level" },   // Second tank: fires together with channel 0
+    // { 16, 17, 0, "tank/level/1" },   // Redundant sensor on tank 1: fires after channel 0
+};
+const int SONAR_CHANNEL_COUNT = sizeof(SONAR_CHANNELS) / sizeof(SONAR_CHANNELS[0]);
+static_assert(SONAR_CHANNEL_COUNT <= 32, "Sonar channels are scheduled with 32-bit masks");
+
 // ==================== TIMING CONFIGURATION ====================
-const int SAMPLING_FREQUENCY_MS = 1000;  // 1 Hz (F parameter)
-const int RECONNECT_DELAY_MS = 5000;
+const int SAMPLING_FREQUENCY_MS = 1000;  // 1 Hz (F parameter), initial period
+const unsigned long RECONNECT_BASE_DELAY_MS = 250;   // Backoff after the first failed retry
+const unsigned long RECONNECT_MAX_DELAY_MS = 30000;  // Backoff cap
+const uint16_t MQTT_CONNECT_TIMEOUT_S = 2;           // Bounds a blocking connect attempt
+const int SONAR_ECHO_TIMEOUT_MS = 30;     // Max echo wait (~5 m round trip)
+const int SONAR_GUARD_MS = 20;           // Reverberation decay before the next slot of a group fires
+
+// ==================== SONAR ACOUSTICS ====================
+const float SONAR_MAX_RANGE_CM = 400.0;              // Longer readings are discarded
+const int16_t AMBIENT_TEMPERATURE_DECI_C = 200;      // Air temperature without a sensor (0.1 C)
+const int TEMPERATURE_SENSOR_PIN = -1;               // TMP36 analog output, -1 = no sensor
+const unsigned long TEMPERATURE_REFRESH_MS = 30000;  // Speed of sound update period
+
+// ==================== ADAPTIVE SAMPLING ====================
+const bool ADAPTIVE_SAMPLING_ENABLED = true;     // false = fixed SAMPLING_FREQUENCY_MS
+const uint32_t SAMPLING_MIN_PERIOD_MS = 200;     // 5 Hz when rising fast or near L1/L2
+const uint32_t SAMPLING_MAX_PERIOD_MS = 4000;    // Stable tank
+const float SAMPLING_TARGET_STEP_CM = 0.5;       // Desired level change between samples
+const float SAMPLING_NEAR_THRESHOLD_CM = 5.0;    // Proximity to L1/L2 that speeds sampling up
+const float SAMPLING_RATE_SMOOTHING = 0.5;       // EWMA weight of the newest rate estimate
+const float SAMPLING_BACKOFF_FACTOR = 1.5;       // Max period growth per sample
+
+// ==================== PUBLISH POLICY ====================
+// L1/L2 must match tank.l1/tank.l2 in the CUS configuration
+const float LEVEL_L1_CM = 20.0;
+const float LEVEL_L2_CM = 40.0;
+const float PUBLISH_DEADBAND_CM = 0.5;         // Smaller moves are not published
+const unsigned long PUBLISH_HEARTBEAT_MS = 4000;  // Must stay below the CUS T2 timeout
+
+// ==================== EDGE ALARMS ====================
+// T1 must match tank.t1 in the CUS configuration
+const bool ALARM_ENGINE_ENABLED = true;          // Publish alerts on MQTT_TOPIC_ALERT
+const unsigned long LEVEL_T1_MS = 10000;         // Time between L1 and L2 before opening 50%
+const uint32_t ALARM_QUEUE_CAPACITY = 8;         // Alerts buffered between sonarTask and mqttTask
+
+// ==================== OFFLINE BUFFER ====================
+const uint32_t OFFLINE_RAM_CAPACITY = 256;       // Samples kept in RAM (~4 min at 1 Hz)
+const uint32_t OFFLINE_SPILL_CHUNK = 64;         // Samples moved to flash per append
+const uint32_t OFFLINE_LOG_MAX_RECORDS = 16384;  // Flash log cap (~4.5 h at 1 Hz, 384 KB)
+const char* OFFLINE_LOG_PATH = "/backlog.bin";
+const uint32_t BACKFILL_BATCH_SIZE = 20;         // Samples per backfill publish
+const unsigned long BACKFILL_INTERVAL_MS = 500;  // Min gap between backfill publishes
+
+// ==================== TELEMETRY FORMAT ====================
+const uint16_t DEVICE_ID = 1;                        // Identifies this TMS in binary payloads
+const bool TELEMETRY_TEXT_ENABLED = true;            // Plain "%.2f" on MQTT_TOPIC_LEVEL
+const bool TELEMETRY_BINARY_ENABLED = false;         // Batched binary on MQTT_TOPIC_BINARY
+const uint8_t TELEMETRY_BATCH_MAX_SAMPLES = 32;
+// With mqtt.format=binary the CUS takes its live level from the batches, so a
+// window at or above tank.t2 (10 s) would let the TMS link time out between them
+const unsigned long TELEMETRY_BATCH_WINDOW_MS = 3000;  // Must stay below the CUS T2 timeout
+static_assert(TELEMETRY_BATCH_WINDOW_MS <= PUBLISH_HEARTBEAT_MS, "binary batches must refresh the CUS link like the heartbeat");
+
+// ==================== LOGGING ====================
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO                 // Calls above this level compile out (-DLOG_LEVEL=n)
+#endif
+const uint32_t LOG_RING_CAPACITY = 64;           // Records waiting for logTask (power of two)
+const int LOG_LINE_SIZE = 96;                    // Longest formatted message
+
+// ==================== DIAGNOSTICS ====================
+const unsigned long DIAG_INTERVAL_MS = 60000;    // Diagnostics publish period
+const uint32_t DIAG_HISTOGRAM_BUCKETS = 16;      // Log2 us buckets, last one >= 32 ms
+const int DIAG_MAX_TRACKED_TASKS = 4;
+const int DIAG_MAX_SYSTEM_TASKS = 24;
+
+// ==================== POWER MANAGEMENT ====================
+enum PowerMode {
+    POWER_ACTIVE,       // Radio and CPU always on (mains powered)
+    POWER_LIGHT_SLEEP,  // Modem sleep + automatic light sleep between samples
+    POWER_DEEP_SLEEP    // Samples batched in RTC memory, radio every N samples
+};
+const PowerMode POWER_MODE = POWER_ACTIVE;
+const int LIGHT_SLEEP_MIN_FREQ_MHZ = 40;            // CPU clock while idle (XTAL)
+const unsigned long MQTT_IDLE_WAIT_MS = 5000;       // Max mqttTask sleep, below the 15 s keepalive
+const unsigned long DEEP_SLEEP_PERIOD_MS = 1000;    // Sampling period in deep-sleep mode
+const uint8_t DEEP_SLEEP_BATCH_SAMPLES = 8;         // Radio every N samples, keep N * period < CUS T2
+const unsigned long DEEP_SLEEP_RADIO_TIMEOUT_MS = 5000;  // Give up on WiFi/MQTT and go back to sleep
+
+// ==================== TASK CONFIGURATION ====================
+const int ACQUISITION_CORE = 1;          // sonarTask + echo ISR (setup() runs here)
+const int NETWORK_CORE = 0;              // mqttTask, shares the core with the WiFi stack
+const uint32_t SAMPLE_RING_CAPACITY = 64;  // Samples buffered between sonarTask and mqttTask
 
 #endif // TMS_CONFIG_H
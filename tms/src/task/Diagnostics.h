@@ -0,0 +1,110 @@
+/**
+ * TMS Diagnostics
+ * Runtime instrumentation published on MQTT_TOPIC_DIAG:
+ * latency histograms, task stack/CPU usage and heap statistics
+ */
+
+#ifndef TMS_DIAGNOSTICS_H
+#define TMS_DIAGNOSTICS_H
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include "Config.h"
+
+// ==================== LATENCY HISTOGRAM ====================
+
+/**
+ * Log2 latency histogram: bucket i counts values in [2^i, 2^(i+1)) us,
+ * the last bucket everything above. Single writer, cumulative since boot.
+ */
+struct LatencyHistogram {
+    uint32_t buckets[DIAG_HISTOGRAM_BUCKETS];
+    uint32_t count;
+    uint32_t maxUs;
+};
+
+LatencyHistogram acquisitionLatency = {};  // Trigger to converted sample (sonarTask)
+LatencyHistogram publishLatency = {};      // Duration of a publish call (mqttTask)
+
+void recordLatency(LatencyHistogram& histogram, uint32_t us) {
+    uint32_t bucket = 0;
+    while (bucket < DIAG_HISTOGRAM_BUCKETS - 1 && (us >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+    histogram.buckets[bucket]++;
+    histogram.count++;
+    if (us > histogram.maxUs) {
+        histogram.maxUs = us;
+    }
+}
+
+// ==================== JSON HELPERS ====================
+
+/**
+ * Append formatted text to a bounded buffer
+ * @return New length (>= size means truncated)
+ */
+int appendf(char* buffer, int len, int size, const char* format, ...) {
+    if (len >= size) {
+        return len;
+    }
+    va_list args;
+    va_start(args, format);
+    len += vsnprintf(buffer + len, size - len, format, args);
+    va_end(args);
+    return len;
+}
+
+/**
+ * Append a histogram as {"n":..,"max":..,"hist":[...]}
+ */
+int appendHistogram(char* buffer, int len, int size, const char* name, const LatencyHistogram& histogram) {
+    len = appendf(buffer, len, size, "\"%s\":{\"n\":%lu,\"max\":%lu,\"hist\":[", name,
+                  (unsigned long)histogram.count, (unsigned long)histogram.maxUs);
+    for (uint32_t i = 0; i < DIAG_HISTOGRAM_BUCKETS; i++) {
+        len = appendf(buffer, len, size, i > 0 ? ",%lu" : "%lu", (unsigned long)histogram.buckets[i]);
+    }
+    return appendf(buffer, len, size, "]}");
+}
+
+// ==================== TASK STATISTICS ====================
+
+/**
+ * Per-task CPU share over the last diagnostics interval, in percent of one
+ * core (a task keeping a core busy reads 100 on either core of the S3)
+ * Needs FreeRTOS run time stats; -1 when the build does not provide them
+ */
+struct TaskCpuTracker {
+    uint32_t lastTotal;
+    uint32_t lastTask[DIAG_MAX_TRACKED_TASKS];
+};
+
+TaskCpuTracker cpuTracker = {};
+
+void sampleTaskCpu(TaskHandle_t* handles, int count, int* cpuPercent) {
+    for (int i = 0; i < count; i++) {
+        cpuPercent[i] = -1;
+    }
+#if (configUSE_TRACE_FACILITY == 1) && (configGENERATE_RUN_TIME_STATS == 1)
+    TaskStatus_t status[DIAG_MAX_SYSTEM_TASKS];
+    uint32_t total = 0;
+    UBaseType_t n = uxTaskGetSystemState(status, DIAG_MAX_SYSTEM_TASKS, &total);
+    uint32_t totalDelta = total - cpuTracker.lastTotal;
+    
+    for (int i = 0; i < count && i < DIAG_MAX_TRACKED_TASKS; i++) {
+        for (UBaseType_t j = 0; j < n; j++) {
+            if (status[j].xHandle == handles[i]) {
+                uint32_t delta = status[j].ulRunTimeCounter - cpuTracker.lastTask[i];
+                cpuTracker.lastTask[i] = status[j].ulRunTimeCounter;
+                if (totalDelta > 0) {
+                    // total is wall-clock run time, not a sum over the cores
+                    cpuPercent[i] = (int)((uint64_t)delta * 100 / totalDelta);
+                }
+            }
+        }
+    }
+    cpuTracker.lastTotal = total;
+#endif
+}
+
+#endif // TMS_DIAGNOSTICS_H
@@ -7,6 +7,7 @@
 #define TMS_FSM_H
 
 #include <Arduino.h>
+#include "Log.h"
 
 // ==================== FSM STATES ====================
 enum SystemState {
@@ -20,6 +21,9 @@ enum SystemState {
 // Global state variable
 extern volatile SystemState currentState;
 
+// Woken on every transition to update the LEDs
+extern TaskHandle_t ledTaskHandle;
+
 // ==================== FSM FUNCTIONS ====================
 
 /**
@@ -27,12 +31,12 @@ extern volatile SystemState currentState;
  */
 void handleStateTransition(SystemState newState) {
     if (currentState != newState) {
-        Serial.print("State transition: ");
-        Serial.print(currentState);
-        Serial.print(" -> ");
-        Serial.println(newState);
+        LOG_INFO("State transition: %ld -> %ld", (int32_t)currentState, (int32_t)newState);
         
         currentState = newState;
+        if (ledTaskHandle) {
+            xTaskNotifyGive(ledTaskHandle);
+        }
     }
 }
 
@@ -0,0 +1,116 @@
+/**
+ * TMS Fixed-Point Levels
+ * Levels are int32 in 0.1 mm (LEVEL_UNITS_PER_CM per cm) from the echo
+ * capture to serialization; floats only appear in the cm settings of Config.h.
+ * The echo width is converted with a temperature-compensated speed of sound.
+ */
+
+#ifndef TMS_LEVEL_H
+#define TMS_LEVEL_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// ==================== UNITS ====================
+
+const int32_t LEVEL_UNITS_PER_CM = 100;  // 0.1 mm, same scale as the binary telemetry
+
+/**
+ * Convert a cm setting to level units (rounded)
+ */
+int32_t levelFromCm(float cm) {
+    return (int32_t)(cm * LEVEL_UNITS_PER_CM + (cm < 0 ? -0.5f : 0.5f));
+}
+
+// Settings of Config.h in level units
+const int32_t LEVEL_L1_UNITS = levelFromCm(LEVEL_L1_CM);
+const int32_t LEVEL_L2_UNITS = levelFromCm(LEVEL_L2_CM);
+const int32_t PUBLISH_DEADBAND_UNITS = levelFromCm(PUBLISH_DEADBAND_CM);
+const int32_t SAMPLING_TARGET_STEP_UNITS = levelFromCm(SAMPLING_TARGET_STEP_CM);
+const int32_t SAMPLING_NEAR_THRESHOLD_UNITS = levelFromCm(SAMPLING_NEAR_THRESHOLD_CM);
+const int32_t SONAR_MAX_RANGE_UNITS = levelFromCm(SONAR_MAX_RANGE_CM);
+
+/**
+ * Format a level as cm with two decimals ("30.00"), like "%.2f" but
+ * with integer arithmetic only
+ * @return Characters written (as snprintf)
+ */
+int formatLevel(char* buffer, size_t size, int32_t level) {
+    uint32_t magnitude = level < 0 ? (uint32_t)(-(int64_t)level) : (uint32_t)level;
+    return snprintf(buffer, size, "%s%lu.%02lu", level < 0 ? "-" : "",
+                    (unsigned long)(magnitude / LEVEL_UNITS_PER_CM),
+                    (unsigned long)(magnitude % LEVEL_UNITS_PER_CM));
+}
+
+// ==================== SPEED OF SOUND ====================
+
+/**
+ * Speed of sound in dry air in cm/s, 331.3 * sqrt(1 + T / 273.15) m/s,
+ * from SOUND_LUT_MIN_DECI_C in SOUND_LUT_STEP_DECI_C steps
+ */
+const int16_t SOUND_LUT_MIN_DECI_C = -200;
+const int16_t SOUND_LUT_STEP_DECI_C = 50;
+const uint16_t SOUND_SPEED_LUT[] = {
+    31894, 32207, 32518, 32825, 33130,  // -20 .. 0 C
+    33432, 33731, 34028, 34321, 34613,  // 5 .. 25 C
+    34902, 35189, 35473, 35755, 36035   // 30 .. 50 C
+};
+const int SOUND_LUT_SIZE = sizeof(SOUND_SPEED_LUT) / sizeof(SOUND_SPEED_LUT[0]);
+
+/**
+ * Speed of sound at a temperature, linearly interpolated and clamped to the table
+ * @param tempDeciC Temperature in 0.1 C
+ * @return Speed in cm/s
+ */
+uint32_t speedOfSoundCmPerS(int16_t tempDeciC) {
+    int32_t offset = tempDeciC - SOUND_LUT_MIN_DECI_C;
+    if (offset <= 0) {
+        return SOUND_SPEED_LUT[0];
+    }
+    int32_t index = offset / SOUND_LUT_STEP_DECI_C;
+    if (index >= SOUND_LUT_SIZE - 1) {
+        return SOUND_SPEED_LUT[SOUND_LUT_SIZE - 1];
+    }
+    int32_t fraction = offset % SOUND_LUT_STEP_DECI_C;
+    int32_t low = SOUND_SPEED_LUT[index];
+    int32_t high = SOUND_SPEED_LUT[index + 1];
+    return (uint32_t)(low + (high - low) * fraction / SOUND_LUT_STEP_DECI_C);
+}
+
+// ==================== ECHO CONVERSION ====================
+
+/**
+ * level = echoNs * speed[cm/s] / 2e7, applied as a Q32 multiplier so the
+ * per-sample cost is one 32x32->64 multiply and a shift (no division)
+ */
+struct EchoConversion {
+    int16_t tempDeciC;
+    uint32_t speedCmPerS;
+    uint32_t factorQ32;
+};
+
+EchoConversion echoConversion = {};
+
+/**
+ * Recompute the conversion factor for a new air temperature
+ */
+void setEchoTemperature(EchoConversion& conversion, int16_t tempDeciC) {
+    conversion.tempDeciC = tempDeciC;
+    conversion.speedCmPerS = speedOfSoundCmPerS(tempDeciC);
+    conversion.factorQ32 = (uint32_t)((((uint64_t)conversion.speedCmPerS << 32) + 10000000ULL) / 20000000ULL);
+}
+
+/**
+ * Convert an echo pulse width to a level
+ * @param echoNs Echo duration in ns (0 = no echo)
+ * @return Distance in level units, or 0 if out of range
+ */
+int32_t echoToLevel(const EchoConversion& conversion, uint32_t echoNs) {
+    int32_t level = (int32_t)(((uint64_t)echoNs * conversion.factorQ32 + (1ULL << 31)) >> 32);
+    if (echoNs == 0 || level > SONAR_MAX_RANGE_UNITS) {
+        return 0;
+    }
+    return level;
+}
+
+#endif // TMS_LEVEL_H
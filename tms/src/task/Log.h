@@ -0,0 +1,215 @@
+/**
+ * TMS Asynchronous Logger
+ * LOG_ERROR/LOG_WARN/LOG_INFO/LOG_DEBUG store a binary record (timestamp,
+ * format pointer, up to LOG_MAX_ARGS integer or string-literal arguments)
+ * in a lock-free multi-producer ring; logTask formats and prints them.
+ * A full ring drops the record and counts it, so a logging call never waits
+ * for the UART. Calls above LOG_LEVEL compile out completely.
+ *
+ * Formats are stored by pointer and expanded later: they must be string
+ * literals, arguments must use %lu/%ld/%lx/%s (any integer width), and %s
+ * arguments must point to static strings. No floats: format levels as
+ * integers (see Level.h).
+ */
+
+#ifndef TMS_LOG_H
+#define TMS_LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+#include "Config.h"
+
+// ==================== LOG LEVELS ====================
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+const int LOG_MAX_ARGS = 4;
+
+// ==================== LOG RECORD ====================
+
+struct LogRecord {
+    uint32_t ms;                  // millis() when logged, not when printed
+    uint8_t level;
+    const char* format;
+    uintptr_t args[LOG_MAX_ARGS];
+};
+
+// ==================== MPSC RING ====================
+
+/**
+ * Bounded multi-producer/single-consumer ring (per-slot sequence numbers)
+ * Producers claim a slot with a CAS on head, fill it and publish it by
+ * advancing its sequence; the consumer only reads slots published that way.
+ * Never blocks: a full ring rejects the record.
+ * @tparam T Element type
+ * @tparam N Capacity (power of two)
+ */
+template <typename T, uint32_t N>
+class MpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "MpscRing capacity must be a power of two");
+
+public:
+    MpscRing() {
+        for (uint32_t i = 0; i < N; i++) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Producer side (any task)
+     * @return false if the ring was full (element dropped)
+     */
+    bool push(const T& item) {
+        uint32_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & (N - 1)];
+            int32_t diff = (int32_t)(cell.seq.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.item = item;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                overflows.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Consumer side (one task only)
+     * @return false if the ring was empty
+     */
+    bool pop(T& item) {
+        Cell& cell = cells[tail & (N - 1)];
+        if (cell.seq.load(std::memory_order_acquire) != tail + 1) {
+            return false;
+        }
+        item = cell.item;
+        cell.seq.store(tail + N, std::memory_order_release);
+        tail++;
+        return true;
+    }
+
+    uint32_t overflowCount() const { return overflows.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> seq;
+        T item;
+    };
+
+    Cell cells[N];
+    std::atomic<uint32_t> head{0};
+    uint32_t tail = 0;
+    std::atomic<uint32_t> overflows{0};
+};
+
+// ==================== LOGGER ====================
+
+MpscRing<LogRecord, LOG_RING_CAPACITY> logRing;
+TaskHandle_t logTaskHandle = NULL;
+uint32_t logReportedDrops = 0;    // Owned by the draining side
+
+template <typename T>
+uintptr_t logArg(T value) {
+    static_assert(!std::is_floating_point<T>::value, "log arguments must be integers or static strings");
+    return (uintptr_t)value;
+}
+
+/**
+ * Queue a record for logTask (use the LOG_* macros)
+ * @return false if the record was dropped
+ */
+template <typename... Args>
+bool logWrite(uint8_t level, const char* format, Args... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+    LogRecord record = { (uint32_t)millis(), level, format, { logArg(args)... } };
+    if (!logRing.push(record)) {
+        return false;
+    }
+    if (logTaskHandle) {
+        xTaskNotifyGive(logTaskHandle);
+    }
+    return true;
+}
+
+// Disabled levels are dead code: nothing is emitted, but the arguments still count as used
+#define LOG_DISABLED(...) ((void)(false && logWrite(LOG_LEVEL_NONE, __VA_ARGS__)))
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+// ==================== DRAIN ====================
+
+/**
+ * Print every queued record ("[ms] L message"), then a line for records
+ * dropped since the last report
+ * Called by logTask, or directly when no task runs (deep sleep)
+ */
+void logDrain() {
+    static const char LEVEL_TAGS[] = "-EWID";
+    LogRecord record;
+    char line[LOG_LINE_SIZE];
+
+    while (logRing.pop(record)) {
+        snprintf(line, sizeof(line), record.format,
+                 record.args[0], record.args[1], record.args[2], record.args[3]);
+        Serial.print('[');
+        Serial.print(record.ms);
+        Serial.print("] ");
+        Serial.print(LEVEL_TAGS[record.level]);
+        Serial.print(' ');
+        Serial.println(line);
+    }
+
+    uint32_t drops = logRing.overflowCount();
+    if (drops != logReportedDrops) {
+        Serial.print("[log] dropped ");
+        Serial.print(drops - logReportedDrops);
+        Serial.println(" record(s)");
+        logReportedDrops = drops;
+    }
+}
+
+/**
+ * Log Task: lowest-priority consumer of the log ring
+ * Woken by each record; blocking on the UART only delays this task
+ */
+void logTask(void* parameter) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        logDrain();
+    }
+}
+
+#endif // TMS_LOG_H
@@ -25,6 +25,9 @@ void setupWiFi() {
     Serial.println(WIFI_SSID);
     
     WiFi.mode(WIFI_STA);
+    if (POWER_MODE == POWER_LIGHT_SLEEP) {
+        WiFi.setSleep(WIFI_PS_MAX_MODEM);  // Radio only wakes for DTIM beacons
+    }
     WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
     
     // Non-blocking connection check will be done in mqttTask
@@ -54,6 +57,8 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
 void setupMQTT() {
     mqttClient.setServer(MQTT_BROKER, MQTT_PORT);
     mqttClient.setCallback(mqttCallback);
+    mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
+    mqttClient.setSocketTimeout(MQTT_CONNECT_TIMEOUT_S);
     Serial.println("MQTT client configured");
 }
 
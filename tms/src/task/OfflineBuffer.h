@@ -0,0 +1,157 @@
+/**
+ * TMS Offline Buffer
+ * Store-and-forward of samples taken while the network is down:
+ * a RAM ring that spills its oldest records to a LittleFS log
+ */
+
+#ifndef TMS_OFFLINE_BUFFER_H
+#define TMS_OFFLINE_BUFFER_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "Config.h"
+#include "SampleRing.h"
+
+// ==================== BUFFER STATE ====================
+
+/**
+ * Backlog owned by mqttTask (single-threaded access)
+ * Invariant: every record in the spill log is older than every record in RAM,
+ * so draining the log first and then RAM preserves capture order.
+ */
+struct OfflineBuffer {
+    SpscRing<LevelSample, OFFLINE_RAM_CAPACITY> ram;
+    bool fsReady;
+    uint32_t spillWritten;   // Records in the spill log
+    uint32_t spillRead;      // Records of the log already forwarded
+    
+    // Counters
+    uint32_t stored;
+    uint32_t spilled;
+    uint32_t dropped;
+    uint32_t forwarded;
+};
+
+OfflineBuffer offlineBuffer;
+
+// ==================== SPILL LOG ====================
+
+/**
+ * Mount the filesystem and discard the log of a previous boot
+ * (capture timestamps do not survive a reset)
+ */
+void setupOfflineBuffer() {
+    offlineBuffer.fsReady = LittleFS.begin(true);
+    if (offlineBuffer.fsReady && LittleFS.exists(OFFLINE_LOG_PATH)) {
+        LittleFS.remove(OFFLINE_LOG_PATH);
+    }
+    Serial.println(offlineBuffer.fsReady ? "Offline log ready" : "Offline log unavailable (RAM only)");
+}
+
+/**
+ * Move the oldest OFFLINE_SPILL_CHUNK records from RAM to the log
+ * One append per chunk keeps flash writes coarse
+ * @return false if nothing could be spilled
+ */
+bool spillOldest() {
+    if (!offlineBuffer.fsReady || offlineBuffer.spillWritten + OFFLINE_SPILL_CHUNK > OFFLINE_LOG_MAX_RECORDS) {
+        return false;
+    }
+    
+    LevelSample chunk[OFFLINE_SPILL_CHUNK];
+    uint32_t count = 0;
+    while (count < OFFLINE_SPILL_CHUNK && offlineBuffer.ram.pop(chunk[count])) {
+        count++;
+    }
+    
+    File log = LittleFS.open(OFFLINE_LOG_PATH, FILE_APPEND);
+    if (!log) {
+        offlineBuffer.dropped += count;
+        return count > 0;
+    }
+    log.write((const uint8_t*)chunk, count * sizeof(LevelSample));
+    log.close();
+    
+    offlineBuffer.spillWritten += count;
+    offlineBuffer.spilled += count;
+    return count > 0;
+}
+
+// ==================== BUFFER FUNCTIONS ====================
+
+/**
+ * Append a sample to the backlog
+ * When RAM and log are both full the new sample is dropped and counted
+ */
+void offlineStore(const LevelSample& sample) {
+    if (offlineBuffer.ram.size() == offlineBuffer.ram.capacity() && !spillOldest()) {
+        offlineBuffer.dropped++;
+        return;
+    }
+    offlineBuffer.ram.push(sample);
+    offlineBuffer.stored++;
+}
+
+/**
+ * Number of samples waiting to be forwarded
+ */
+uint32_t offlineSize() {
+    return (offlineBuffer.spillWritten - offlineBuffer.spillRead) + offlineBuffer.ram.size();
+}
+
+/**
+ * Copy the oldest samples without removing them
+ * @param out Destination array
+ * @param max Capacity of out
+ * @return Number of samples copied (all from the log, or all from RAM)
+ */
+uint32_t offlinePeekBatch(LevelSample* out, uint32_t max) {
+    uint32_t pendingLog = offlineBuffer.spillWritten - offlineBuffer.spillRead;
+    
+    if (pendingLog > 0) {
+        uint32_t count = pendingLog < max ? pendingLog : max;
+        File log = LittleFS.open(OFFLINE_LOG_PATH, FILE_READ);
+        if (!log || !log.seek(offlineBuffer.spillRead * sizeof(LevelSample))) {
+            return 0;
+        }
+        count = log.read((uint8_t*)out, count * sizeof(LevelSample)) / sizeof(LevelSample);
+        log.close();
+        return count;
+    }
+    
+    uint32_t count = 0;
+    while (count < max) {
+        const LevelSample* sample = offlineBuffer.ram.peek(count);
+        if (!sample) {
+            break;
+        }
+        out[count++] = *sample;
+    }
+    return count;
+}
+
+/**
+ * Drop the samples returned by the last offlinePeekBatch once forwarded
+ */
+void offlineConsume(uint32_t count) {
+    uint32_t pendingLog = offlineBuffer.spillWritten - offlineBuffer.spillRead;
+    
+    if (pendingLog > 0) {
+        offlineBuffer.spillRead += count;
+        if (offlineBuffer.spillRead >= offlineBuffer.spillWritten) {
+            // Log fully forwarded: start a fresh one
+            LittleFS.remove(OFFLINE_LOG_PATH);
+            offlineBuffer.spillRead = 0;
+            offlineBuffer.spillWritten = 0;
+        }
+    } else {
+        LevelSample discarded;
+        uint32_t removed = 0;
+        while (removed < count && offlineBuffer.ram.pop(discarded)) {
+            removed++;
+        }
+    }
+    offlineBuffer.forwarded += count;
+}
+
+#endif // TMS_OFFLINE_BUFFER_H
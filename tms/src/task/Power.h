@@ -0,0 +1,195 @@
+/**
+ * TMS Power Management
+ * Selectable power modes (POWER_MODE in Config.h):
+ * - POWER_ACTIVE: original behaviour, radio and CPU always on
+ * - POWER_LIGHT_SLEEP: WiFi modem sleep plus automatic light sleep while
+ *   all tasks are blocked between samples
+ * - POWER_DEEP_SLEEP: one sample per wake, batched in RTC memory; the radio
+ *   only comes up every DEEP_SLEEP_BATCH_SAMPLES samples or on an alarm change
+ */
+
+#ifndef TMS_POWER_H
+#define TMS_POWER_H
+
+#include <Arduino.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include "Config.h"
+#include "SampleRing.h"
+#include "Diagnostics.h"
+#include "AlarmEngine.h"
+#include "Log.h"
+
+// ==================== POWER STATISTICS ====================
+
+/**
+ * Duty-cycle and wake-to-publish statistics
+ * Busy times are measured around the sampling and network work, so their
+ * sum over the uptime is an upper bound of the share the chip stayed awake
+ */
+struct PowerStats {
+    uint32_t wakes;                // Sampling cycles
+    uint32_t radioWakes;           // Deep sleep: wakes that brought the radio up
+    uint64_t sampleBusyUs;         // Written by the sampling side only
+    uint64_t networkBusyUs;        // Written by the network side only
+    uint64_t sleepUs;              // Deep sleep: time spent asleep
+    uint32_t lastWakeToPublishMs;  // Sample capture (or wake-up) to publish done
+    uint32_t maxWakeToPublishMs;
+};
+
+PowerStats powerStats = {};
+
+void recordWakeToPublish(PowerStats& stats, uint64_t latencyUs) {
+    stats.lastWakeToPublishMs = (uint32_t)(latencyUs / 1000);
+    if (stats.lastWakeToPublishMs > stats.maxWakeToPublishMs) {
+        stats.maxWakeToPublishMs = stats.lastWakeToPublishMs;
+    }
+}
+
+const char* powerModeName() {
+    switch (POWER_MODE) {
+        case POWER_LIGHT_SLEEP: return "light_sleep";
+        case POWER_DEEP_SLEEP: return "deep_sleep";
+        default: return "active";
+    }
+}
+
+/**
+ * Append the statistics as "power":{...}
+ * @param uptimeUs Time the statistics cover (awake + asleep)
+ */
+int appendPowerStats(char* buffer, int len, int size, const PowerStats& stats, uint64_t uptimeUs) {
+    uint64_t busyUs = stats.sampleBusyUs + stats.networkBusyUs;
+    uint32_t dutyPermille = uptimeUs > 0 ? (uint32_t)(busyUs * 1000 / uptimeUs) : 0;
+    return appendf(buffer, len, size,
+                   "\"power\":{\"mode\":\"%s\",\"wakes\":%lu,\"radio_wakes\":%lu,\"duty_pct\":%lu.%lu"
+                   ",\"sample_busy_ms\":%lu,\"net_busy_ms\":%lu,\"sleep_ms\":%lu"
+                   ",\"wake_pub_last_ms\":%lu,\"wake_pub_max_ms\":%lu}",
+                   powerModeName(), (unsigned long)stats.wakes, (unsigned long)stats.radioWakes,
+                   (unsigned long)(dutyPermille / 10), (unsigned long)(dutyPermille % 10),
+                   (unsigned long)(stats.sampleBusyUs / 1000), (unsigned long)(stats.networkBusyUs / 1000),
+                   (unsigned long)(stats.sleepUs / 1000),
+                   (unsigned long)stats.lastWakeToPublishMs, (unsigned long)stats.maxWakeToPublishMs);
+}
+
+// ==================== LIGHT SLEEP ====================
+
+#if CONFIG_PM_ENABLE
+esp_pm_lock_handle_t capturePmLock = NULL;
+#endif
+
+/**
+ * Enable dynamic frequency scaling and automatic light sleep
+ * Needs a build with CONFIG_PM_ENABLE (and CONFIG_FREERTOS_USE_TICKLESS_IDLE
+ * for light sleep); otherwise only WiFi modem sleep is used
+ */
+void setupPowerMode() {
+    if (POWER_MODE != POWER_LIGHT_SLEEP) {
+        return;
+    }
+#if CONFIG_PM_ENABLE
+    esp_pm_config_esp32s3_t pm = {};
+    pm.max_freq_mhz = ESP.getCpuFreqMHz();
+    pm.min_freq_mhz = LIGHT_SLEEP_MIN_FREQ_MHZ;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    pm.light_sleep_enable = true;
+#endif
+    if (esp_pm_configure(&pm) != ESP_OK) {
+        Serial.println("Power management configuration failed");
+        return;
+    }
+    // Echo timing runs on the cycle counter: no light sleep or DFS while capturing
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "sonar", &capturePmLock);
+    Serial.println("Light sleep enabled");
+#else
+    Serial.println("Power management not available in this build, modem sleep only");
+#endif
+}
+
+/**
+ * Keep the CPU at full speed and awake during an echo capture
+ */
+void powerHoldForCapture() {
+#if CONFIG_PM_ENABLE
+    if (capturePmLock) {
+        esp_pm_lock_acquire(capturePmLock);
+    }
+#endif
+}
+
+void powerReleaseAfterCapture() {
+#if CONFIG_PM_ENABLE
+    if (capturePmLock) {
+        esp_pm_lock_release(capturePmLock);
+    }
+#endif
+}
+
+// ==================== DEEP SLEEP ====================
+
+const uint32_t DEEP_SLEEP_MAGIC = 0x544D5331;  // "TMS1"
+
+/**
+ * State kept in RTC slow memory across deep sleeps
+ * captureUs of the batched samples is on the deep-sleep timeline
+ * (awake + asleep time since power-on), not on the per-boot timer
+ */
+struct DeepSleepState {
+    uint32_t magic;
+    uint32_t seq;
+    uint64_t timelineUs;   // Timeline at the start of the current wake
+    AlarmEngine alarm;     // T1 is timed on the timeline
+    AlarmEvent pendingAlert;
+    bool hasPendingAlert;
+    uint8_t count;
+    uint32_t dropped;      // Oldest samples lost while the radio kept failing
+    LevelSample samples[DEEP_SLEEP_BATCH_SAMPLES];
+    PowerStats stats;
+};
+
+RTC_DATA_ATTR DeepSleepState rtcState;
+
+/**
+ * Reset the RTC state after a power-on (RTC memory content is undefined)
+ */
+void setupDeepSleepState() {
+    if (rtcState.magic == DEEP_SLEEP_MAGIC) {
+        return;
+    }
+    memset(&rtcState, 0, sizeof(rtcState));
+    rtcState.magic = DEEP_SLEEP_MAGIC;
+}
+
+/**
+ * Add a sample to the RTC batch, dropping the oldest one when full
+ */
+void deepSleepStore(int32_t level, uint32_t echoNs) {
+    if (rtcState.count == DEEP_SLEEP_BATCH_SAMPLES) {
+        memmove(&rtcState.samples[0], &rtcState.samples[1],
+                (DEEP_SLEEP_BATCH_SAMPLES - 1) * sizeof(LevelSample));
+        rtcState.count--;
+        rtcState.dropped++;
+    }
+    LevelSample sample = { rtcState.seq++, 0, rtcState.timelineUs + esp_timer_get_time(), echoNs, level };
+    rtcState.samples[rtcState.count++] = sample;
+}
+
+/**
+ * Arm the wake-up timer for the next period and enter deep sleep
+ */
+void deepSleepUntilNextSample() {
+    uint64_t awakeUs = esp_timer_get_time();
+    uint64_t periodUs = (uint64_t)DEEP_SLEEP_PERIOD_MS * 1000;
+    uint64_t sleepUs = awakeUs < periodUs ? periodUs - awakeUs : 0;
+
+    rtcState.stats.sleepUs += sleepUs;
+    rtcState.timelineUs += awakeUs + sleepUs;
+
+    logDrain();  // No log task in this mode
+    Serial.flush();
+    esp_sleep_enable_timer_wakeup(sleepUs);
+    esp_deep_sleep_start();
+}
+
+#endif // TMS_POWER_H
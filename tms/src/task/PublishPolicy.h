@@ -0,0 +1,96 @@
+/**
+ * TMS Publish Policy
+ * Decides which level samples are worth an MQTT publish:
+ * moves beyond the deadband, threshold band changes, and a low-rate heartbeat
+ */
+
+#ifndef TMS_PUBLISH_POLICY_H
+#define TMS_PUBLISH_POLICY_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "Level.h"
+
+// ==================== POLICY STATE ====================
+
+enum PublishReason {
+    PUBLISH_NONE,        // Suppressed
+    PUBLISH_FIRST,       // First sample after (re)connecting
+    PUBLISH_DEADBAND,    // Level moved beyond PUBLISH_DEADBAND_CM
+    PUBLISH_BAND,        // Crossed L1 or L2
+    PUBLISH_HEARTBEAT    // Nothing sent for PUBLISH_HEARTBEAT_MS
+};
+
+struct PublishPolicy {
+    bool hasPublished;
+    int32_t lastLevel;
+    int lastBand;
+    unsigned long lastPublishMs;
+    
+    // Counters
+    uint32_t sent;
+    uint32_t suppressed;
+    uint32_t heartbeats;
+};
+
+// ==================== POLICY FUNCTIONS ====================
+
+/**
+ * Threshold band of a level, using the same comparisons as the CUS policy
+ * @return 0 = at or below L1, 1 = between L1 and L2, 2 = at or above L2
+ */
+int levelBand(int32_t level) {
+    if (level >= LEVEL_L2_UNITS) {
+        return 2;
+    }
+    if (level > LEVEL_L1_UNITS) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Forget the last published value so the next sample is always sent
+ * (called on every new MQTT session)
+ */
+void resetPublishPolicy(PublishPolicy& policy) {
+    policy.hasPublished = false;
+}
+
+/**
+ * Decide whether a sample must be published and update the counters
+ * @param level Sample level in level units
+ * @param nowMs Current time in ms
+ * @return Why the sample is published, or PUBLISH_NONE if suppressed
+ */
+PublishReason evaluatePublish(PublishPolicy& policy, int32_t level, unsigned long nowMs) {
+    PublishReason reason = PUBLISH_NONE;
+    int band = levelBand(level);
+    
+    if (!policy.hasPublished) {
+        reason = PUBLISH_FIRST;
+    } else if (band != policy.lastBand) {
+        reason = PUBLISH_BAND;
+    } else if (abs(level - policy.lastLevel) >= PUBLISH_DEADBAND_UNITS) {
+        reason = PUBLISH_DEADBAND;
+    } else if (nowMs - policy.lastPublishMs >= PUBLISH_HEARTBEAT_MS) {
+        reason = PUBLISH_HEARTBEAT;
+    }
+    
+    if (reason == PUBLISH_NONE) {
+        policy.suppressed++;
+        return reason;
+    }
+    
+    policy.hasPublished = true;
+    policy.lastLevel = level;
+    policy.lastBand = band;
+    policy.lastPublishMs = nowMs;
+    policy.sent++;
+    if (reason == PUBLISH_HEARTBEAT) {
+        policy.heartbeats++;
+    }
+    return reason;
+}
+
+#endif // TMS_PUBLISH_POLICY_H
@@ -0,0 +1,91 @@
+/**
+ * TMS Reconnect Backoff
+ * MQTT reconnect scheduling: immediate first retry, exponential backoff
+ * capped at RECONNECT_MAX_DELAY_MS, randomized per device, plus
+ * time-to-recover measurement
+ */
+
+#ifndef TMS_RECONNECT_H
+#define TMS_RECONNECT_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// ==================== BACKOFF STATE ====================
+
+struct ReconnectBackoff {
+    bool inOutage;
+    unsigned long outageStartMs;
+    unsigned long nextAttemptMs;
+    uint8_t failures;            // Consecutive failed attempts in this outage
+    
+    // Statistics
+    uint32_t attempts;
+    uint32_t recoveries;
+    unsigned long lastRecoveryMs;
+    unsigned long maxRecoveryMs;
+};
+
+// ==================== BACKOFF FUNCTIONS ====================
+
+/**
+ * Start timing an outage; the first attempt is due immediately
+ */
+void backoffStartOutage(ReconnectBackoff& backoff, unsigned long nowMs) {
+    if (backoff.inOutage) {
+        return;
+    }
+    backoff.inOutage = true;
+    backoff.outageStartMs = nowMs;
+    backoff.nextAttemptMs = nowMs;
+    backoff.failures = 0;
+}
+
+bool backoffAttemptDue(const ReconnectBackoff& backoff, unsigned long nowMs) {
+    return (long)(nowMs - backoff.nextAttemptMs) >= 0;
+}
+
+/**
+ * Schedule the next attempt after a failure
+ * Delay = random in [d/2, d] with d = RECONNECT_BASE_DELAY_MS * 2^(failures-1),
+ * capped at RECONNECT_MAX_DELAY_MS ("equal jitter": no lockstep across a fleet)
+ * @return Chosen delay in ms
+ */
+unsigned long backoffFailed(ReconnectBackoff& backoff, unsigned long nowMs) {
+    backoff.attempts++;
+    if (backoff.failures < 31) {
+        backoff.failures++;
+    }
+    
+    unsigned long delayMs = RECONNECT_MAX_DELAY_MS;
+    if (backoff.failures <= 16) {
+        unsigned long exponential = RECONNECT_BASE_DELAY_MS << (backoff.failures - 1);
+        if (exponential < delayMs) {
+            delayMs = exponential;
+        }
+    }
+    delayMs = random(delayMs / 2, delayMs + 1);
+    
+    backoff.nextAttemptMs = nowMs + delayMs;
+    return delayMs;
+}
+
+/**
+ * Close the outage and record its duration
+ * @return Time to recover in ms
+ */
+unsigned long backoffSucceeded(ReconnectBackoff& backoff, unsigned long nowMs) {
+    backoff.attempts++;
+    unsigned long recoveryMs = nowMs - backoff.outageStartMs;
+    
+    backoff.inOutage = false;
+    backoff.failures = 0;
+    backoff.recoveries++;
+    backoff.lastRecoveryMs = recoveryMs;
+    if (recoveryMs > backoff.maxRecoveryMs) {
+        backoff.maxRecoveryMs = recoveryMs;
+    }
+    return recoveryMs;
+}
+
+#endif // TMS_RECONNECT_H
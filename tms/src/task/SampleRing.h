@@ -0,0 +1,109 @@
+/**
+ * TMS Sample Ring
+ * Lock-free single-producer/single-consumer queue of sonar samples
+ * (sonarTask produces, mqttTask consumes; safe across cores)
+ */
+
+#ifndef TMS_SAMPLE_RING_H
+#define TMS_SAMPLE_RING_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// ==================== SAMPLE RECORD ====================
+
+/**
+ * One sonar acquisition
+ */
+struct LevelSample {
+    uint32_t seq;          // Monotonic sample number (gaps = dropped samples)
+    uint8_t channel;       // Sonar channel (sits in padding, the record size is unchanged)
+    uint64_t captureUs;    // esp_timer time of the trigger pulse
+    uint32_t rawEchoNs;    // Echo pulse width as captured
+    int32_t level;         // Distance in level units (0.1 mm)
+};
+
+// ==================== SPSC RING ====================
+
+/**
+ * Fixed-capacity SPSC ring
+ * head is written only by the producer, tail only by the consumer;
+ * release/acquire on the indices publishes the slot contents between cores.
+ * When full, new samples are rejected and counted instead of overwriting
+ * unread ones, so every accepted sample is delivered exactly once.
+ * @tparam T Element type
+ * @tparam N Capacity (power of two)
+ */
+template <typename T, uint32_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+    
+public:
+    /**
+     * Producer side: append an element
+     * @return false if the ring was full (element dropped)
+     */
+    bool push(const T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+        
+        if (h - t >= N) {
+            overflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        
+        slots[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        
+        uint32_t depth = h + 1 - t;
+        if (depth > highWater.load(std::memory_order_relaxed)) {
+            highWater.store(depth, std::memory_order_relaxed);
+        }
+        return true;
+    }
+    
+    /**
+     * Consumer side: take the oldest element
+     * @return false if the ring was empty
+     */
+    bool pop(T& item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t h = head.load(std::memory_order_acquire);
+        
+        if (t == h) {
+            return false;
+        }
+        
+        item = slots[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    
+    /**
+     * Consumer side: look at an element without removing it
+     * @param offset Position from the oldest element
+     * @return nullptr if there is no element at that position
+     */
+    const T* peek(uint32_t offset = 0) const {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t h = head.load(std::memory_order_acquire);
+        return (h - t <= offset) ? nullptr : &slots[(t + offset) & (N - 1)];
+    }
+    
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+    
+    uint32_t capacity() const { return N; }
+    uint32_t overflowCount() const { return overflows.load(std::memory_order_relaxed); }
+    uint32_t highWaterMark() const { return highWater.load(std::memory_order_relaxed); }
+    
+private:
+    T slots[N];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> overflows{0};
+    std::atomic<uint32_t> highWater{0};
+};
+
+#endif // TMS_SAMPLE_RING_H
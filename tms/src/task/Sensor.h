@@ -1,6 +1,6 @@
 /**
  * TMS Sensor Functions
- * Sonar sensor reading and distance calculation
+ * Sonar echo capture and fixed-point, temperature-compensated distance
  */
 
 #ifndef TMS_SENSOR_H
@@ -8,35 +8,230 @@
 
 #include <Arduino.h>
 #include "Config.h"
+#include "Level.h"
 
-// ==================== SENSOR FUNCTIONS ====================
+// ==================== ECHO CAPTURE ====================
 
 /**
- * Read distance from ultrasonic sonar sensor
- * @return Distance in cm, or 0.0 if out of range
+ * Echo capture phases, advanced by the echo pin interrupts
  */
-float readSonarDistance() {
-    // Send ultrasonic pulse
-    digitalWrite(SONAR_TRIG_PIN, LOW);
-    delayMicroseconds(2);
-    digitalWrite(SONAR_TRIG_PIN, HIGH);
-    delayMicroseconds(10);
-    digitalWrite(SONAR_TRIG_PIN, LOW);
+enum EchoPhase {
+    ECHO_IDLE,
+    ECHO_WAIT_RISE,
+    ECHO_WAIT_FALL,
+    ECHO_DONE
+};
+
+/**
+ * Capture state of one channel, written by its echo pin interrupt
+ */
+struct EchoCapture {
+    volatile EchoPhase phase;
+    volatile uint32_t riseCycles;
+    volatile uint32_t widthCycles;
+};
+
+EchoCapture echoCaptures[SONAR_CHANNEL_COUNT];
+TaskHandle_t volatile echoWaiter = NULL;
+
+/**
+ * Echo pin ISR: timestamps both edges with the CPU cycle counter
+ * (~4 ns at 240 MHz) and wakes the waiting task on the falling edge
+ */
+void IRAM_ATTR onSonarEchoEdge(void* arg) {
+    uint32_t now = ESP.getCycleCount();
+    EchoCapture* capture = (EchoCapture*)arg;
+    
+    if (capture->phase == ECHO_WAIT_RISE) {
+        capture->riseCycles = now;
+        capture->phase = ECHO_WAIT_FALL;
+    } else if (capture->phase == ECHO_WAIT_FALL) {
+        capture->widthCycles = now - capture->riseCycles;
+        capture->phase = ECHO_DONE;
+        
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(echoWaiter, &woken);
+        if (woken) {
+            portYIELD_FROM_ISR();
+        }
+    }
+}
+
+// ==================== TRIGGER SCHEDULE ====================
+
+/**
+ * Slots fired one after the other, each a mask of channels fired together
+ * Slot k holds the k-th channel of every acoustic group
+ */
+uint32_t sonarSlots[SONAR_CHANNEL_COUNT];
+int sonarSlotCount = 0;
+
+void buildSonarSchedule() {
+    sonarSlotCount = 0;
+    for (int ch = 0; ch < SONAR_CHANNEL_COUNT; ch++) {
+        // Position of this channel inside its group
+        int slot = 0;
+        for (int other = 0; other < ch; other++) {
+            if (SONAR_CHANNELS[other].group == SONAR_CHANNELS[ch].group) {
+                slot++;
+            }
+        }
+        if (slot == sonarSlotCount) {
+            sonarSlots[sonarSlotCount++] = 0;
+        }
+        sonarSlots[slot] |= 1UL << ch;
+    }
+}
+
+/**
+ * Time one round over all slots takes, including the guard intervals
+ */
+uint32_t sonarRoundMs() {
+    return sonarSlotCount * (SONAR_ECHO_TIMEOUT_MS + 1 + SONAR_GUARD_MS);
+}
+
+/**
+ * Channels one acoustic group can hold at a given sampling period
+ */
+uint32_t sonarMaxChannelsPerGroup(uint32_t periodMs) {
+    return periodMs / (SONAR_ECHO_TIMEOUT_MS + 1 + SONAR_GUARD_MS);
+}
+
+// ==================== AIR TEMPERATURE ====================
+
+unsigned long lastTemperatureMs = 0;
+
+/**
+ * Air temperature used for the speed of sound
+ * TMP36: 500 mV at 0 C, 10 mV/C, so mV - 500 is the temperature in 0.1 C
+ * @return Temperature in 0.1 C (AMBIENT_TEMPERATURE_DECI_C without a sensor)
+ */
+int16_t readAirTemperatureDeciC() {
+    if (TEMPERATURE_SENSOR_PIN < 0) {
+        return AMBIENT_TEMPERATURE_DECI_C;
+    }
+    return (int16_t)((int32_t)analogReadMilliVolts(TEMPERATURE_SENSOR_PIN) - 500);
+}
+
+/**
+ * Refresh the echo conversion from the air temperature every TEMPERATURE_REFRESH_MS
+ */
+void updateEchoTemperature(bool force) {
+    if (!force && millis() - lastTemperatureMs < TEMPERATURE_REFRESH_MS) {
+        return;
+    }
+    lastTemperatureMs = millis();
+    setEchoTemperature(echoConversion, readAirTemperatureDeciC());
+}
+
+// ==================== CAPTURE ====================
+
+/**
+ * Configure the sonar pins and attach the echo capture interrupts
+ * Both edges of a channel are timestamped on the core that runs this, so
+ * the cycle counter difference is always taken on a single core
+ */
+void setupSonarCapture() {
+    for (int ch = 0; ch < SONAR_CHANNEL_COUNT; ch++) {
+        pinMode(SONAR_CHANNELS[ch].trigPin, OUTPUT);
+        pinMode(SONAR_CHANNELS[ch].echoPin, INPUT);
+        echoCaptures[ch].phase = ECHO_IDLE;
+        attachInterruptArg(digitalPinToInterrupt(SONAR_CHANNELS[ch].echoPin),
+                           onSonarEchoEdge, &echoCaptures[ch], CHANGE);
+    }
+    buildSonarSchedule();
+    updateEchoTemperature(true);
     
-    // Measure echo duration
-    long duration = pulseIn(SONAR_ECHO_PIN, HIGH, 30000); // 30ms timeout
+    Serial.print("Sonar: ");
+    Serial.print(SONAR_CHANNEL_COUNT);
+    Serial.print(" channel(s) in ");
+    Serial.print(sonarSlotCount);
+    Serial.print(" slot(s), round ");
+    Serial.print(sonarRoundMs());
+    Serial.print(" ms, max ");
+    Serial.print(sonarMaxChannelsPerGroup(SAMPLING_MIN_PERIOD_MS));
+    Serial.println(" channel(s) per group at the minimum period");
+}
+
+/**
+ * Fire a set of channels together and wait for their echoes without busy-waiting
+ * The calling task sleeps on task notifications until every ISR has seen
+ * its falling edge or the echo timeout expires
+ * @param mask Channels to fire (bit i = channel i)
+ * @param echoNs Per-channel echo pulse width in ns, 0 if no echo arrived
+ */
+void captureEchoesNs(uint32_t mask, uint32_t* echoNs) {
+    echoWaiter = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);  // Drop any stale notification
     
-    // Calculate distance in cm
-    // Speed of sound: 343 m/s = 0.0343 cm/μs
-    // Distance = (duration / 2) * 0.0343
-    float distance = (duration * 0.0343) / 2.0;
+    for (int ch = 0; ch < SONAR_CHANNEL_COUNT; ch++) {
+        if (mask & (1UL << ch)) {
+            echoCaptures[ch].phase = ECHO_WAIT_RISE;
+            digitalWrite(SONAR_CHANNELS[ch].trigPin, LOW);
+        }
+    }
     
-    // Return 0 if out of range
-    if (duration == 0 || distance > 400) {
-        return 0.0;
+    // Send ultrasonic pulses (channels sharing a trigger pin fire once)
+    delayMicroseconds(2);
+    for (int ch = 0; ch < SONAR_CHANNEL_COUNT; ch++) {
+        if (mask & (1UL << ch)) {
+            digitalWrite(SONAR_CHANNELS[ch].trigPin, HIGH);
+        }
+    }
+    delayMicroseconds(10);
+    for (int ch = 0; ch < SONAR_CHANNEL_COUNT; ch++) {
+        if (mask & (1UL << ch)) {
+            digitalWrite(SONAR_CHANNELS[ch].trigPin, LOW);
+        }
+    }
+    
+    // Block until every falling edge (+1 tick so a partial tick never cuts the window short)
+    TickType_t start = xTaskGetTickCount();
+    TickType_t window = pdMS_TO_TICKS(SONAR_ECHO_TIMEOUT_MS) + 1;
+    for (;;) {
+        bool pending = false;
+        for (int ch = 0; ch < SONAR_CHANNEL_COUNT; ch++) {
+            if ((mask & (1UL << ch)) && echoCaptures[ch].phase != ECHO_DONE) {
+                pending = true;
+            }
+        }
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (!pending || elapsed >= window) {
+            break;
+        }
+        ulTaskNotifyTake(pdTRUE, window - elapsed);
     }
     
-    return distance;
+    for (int ch = 0; ch < SONAR_CHANNEL_COUNT; ch++) {
+        if (!(mask & (1UL << ch))) {
+            continue;
+        }
+        bool completed = echoCaptures[ch].phase == ECHO_DONE;
+        echoCaptures[ch].phase = ECHO_IDLE;
+        echoNs[ch] = completed
+            ? (uint32_t)((uint64_t)echoCaptures[ch].widthCycles * 1000 / ESP.getCpuFreqMHz())
+            : 0;
+    }
+}
+
+/**
+ * Fire channel 0 alone and wait for its echo
+ * @return Echo pulse width in ns, or 0 if no echo arrived
+ */
+uint32_t captureEchoNs() {
+    uint32_t echoNs[SONAR_CHANNEL_COUNT];
+    captureEchoesNs(1, echoNs);
+    return echoNs[0];
+}
+
+// ==================== SENSOR FUNCTIONS ====================
+
+/**
+ * Read the level seen by channel 0
+ * @return Distance in level units (0.1 mm), or 0 if out of range
+ */
+int32_t readSonarLevel() {
+    return echoToLevel(echoConversion, captureEchoNs());
 }
 
 #endif // TMS_SENSOR_H
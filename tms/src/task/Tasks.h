@@ -11,40 +11,378 @@
 #include "FSM.h"
 #include "Sensor.h"
 #include "Network.h"
+#include "SampleRing.h"
+#include "PublishPolicy.h"
+#include "OfflineBuffer.h"
+#include "Telemetry.h"
+#include "AdaptiveSampler.h"
+#include "Reconnect.h"
+#include "Diagnostics.h"
+#include "Power.h"
+#include "AlarmEngine.h"
+#include "Log.h"
+#include <esp_timer.h>
 
 // Task handles
 extern TaskHandle_t sonarTaskHandle;
 extern TaskHandle_t mqttTaskHandle;
 extern TaskHandle_t ledTaskHandle;
 
-// Shared water level variable (protected by atomic operations)
-volatile float latestWaterLevel = 0.0;
+// Samples handed from sonarTask (producer) to mqttTask (consumer)
+SpscRing<LevelSample, SAMPLE_RING_CAPACITY> sampleRing;
+uint32_t sampleSeq = 0;                         // Channel 0
+uint32_t channelSeq[SONAR_CHANNEL_COUNT] = {};  // Additional channels
+
+// Sampling period control (owned by sonarTask)
+AdaptiveSampler sampler;
+
+// Edge alarms: evaluated by sonarTask, published by mqttTask ahead of samples
+AlarmEngine alarmEngine = {};
+SpscRing<AlarmEvent, ALARM_QUEUE_CAPACITY> alertRing;
+AlarmEvent pendingAlert;           // Newest alert not yet delivered (owned by mqttTask)
+bool hasPendingAlert = false;
+
+// Change-driven publishing state and counters (owned by mqttTask)
+PublishPolicy publishPolicy = {};
+PublishPolicy channelPolicy[SONAR_CHANNEL_COUNT] = {};  // Additional channels
+unsigned long lastBackfillMs = 0;
+
+// Open binary telemetry batch (owned by mqttTask)
+TelemetryBatch telemetryBatch = {};
+
+// Reconnect scheduling and time-to-recover (owned by mqttTask)
+ReconnectBackoff reconnectBackoff = {};
+
+unsigned long lastDiagMs = 0;
 
 // ==================== FREERTOS TASKS ====================
 
 /**
- * Sonar Task: Reads water level at configured frequency
+ * Process one channel 0 acquisition: alarms, adaptive period, hand-over
+ * @return true if mqttTask should be woken right away
+ */
+bool handlePrimarySample(int32_t waterLevel, uint32_t echoNs, uint64_t captureUs) {
+    // Alarm rules first: an alert must not wait behind the serial log
+    AlarmEvent alert;
+    bool alerted = ALARM_ENGINE_ENABLED &&
+                   evaluateAlarm(alarmEngine, waterLevel, millis(), captureUs, alert);
+    if (alerted) {
+        alertRing.push(alert);
+    }
+    
+    if (ADAPTIVE_SAMPLING_ENABLED) {
+        nextSamplingPeriod(sampler, waterLevel, captureUs);
+    }
+    
+    LOG_INFO("Water Level: %lu.%02lu cm (period %lu ms)",
+             waterLevel / LEVEL_UNITS_PER_CM, waterLevel % LEVEL_UNITS_PER_CM, sampler.periodMs);
+    
+    // Hand the sample over to the MQTT task
+    LevelSample sample = { sampleSeq++, 0, captureUs, echoNs, waterLevel };
+    sampleRing.push(sample);
+    return alerted;
+}
+
+/**
+ * Process one acquisition of an additional channel (live publish only)
+ */
+void handleChannelSample(int channel, int32_t waterLevel, uint32_t echoNs, uint64_t captureUs) {
+    LOG_INFO("Water Level [%ld]: %lu.%02lu cm",
+             channel, waterLevel / LEVEL_UNITS_PER_CM, waterLevel % LEVEL_UNITS_PER_CM);
+    
+    LevelSample sample = { channelSeq[channel]++, (uint8_t)channel, captureUs, echoNs, waterLevel };
+    sampleRing.push(sample);
+}
+
+/**
+ * Sonar Task: Reads water level at an adaptive frequency
+ * Each period fires every trigger slot once, with a guard interval between slots
+ * Keeps sampling in every network state; mqttTask buffers while offline
  */
 void sonarTask(void* parameter) {
     TickType_t lastWakeTime = xTaskGetTickCount();
+    setupAdaptiveSampler(sampler);
+    uint32_t echoNs[SONAR_CHANNEL_COUNT];
     
     for (;;) {
-        if (currentState == STATE_CONNECTED) {
-            float waterLevel = readSonarDistance();
+        bool wakeNetwork = false;
+        bool sampled = false;
+        updateEchoTemperature(false);
+        
+        for (int slot = 0; slot < sonarSlotCount; slot++) {
+            if (slot > 0) {
+                vTaskDelay(pdMS_TO_TICKS(SONAR_GUARD_MS));
+            }
+            uint64_t captureUs = esp_timer_get_time();
+            powerHoldForCapture();
+            captureEchoesNs(sonarSlots[slot], echoNs);
+            powerReleaseAfterCapture();
             
-            if (waterLevel > 0) {
-                Serial.print("Water Level: ");
-                Serial.print(waterLevel);
-                Serial.println(" cm");
-                
-                // Update shared variable for MQTT task
-                latestWaterLevel = waterLevel;
+            for (int ch = 0; ch < SONAR_CHANNEL_COUNT; ch++) {
+                if (!(sonarSlots[slot] & (1UL << ch))) {
+                    continue;
+                }
+                int32_t waterLevel = echoToLevel(echoConversion, echoNs[ch]);
+                if (ch == 0) {
+                    recordLatency(acquisitionLatency, (uint32_t)(esp_timer_get_time() - captureUs));
+                }
+                if (waterLevel <= 0) {
+                    continue;
+                }
+                sampled = true;
+                if (ch == 0) {
+                    wakeNetwork |= handlePrimarySample(waterLevel, echoNs[ch], captureUs);
+                } else {
+                    handleChannelSample(ch, waterLevel, echoNs[ch], captureUs);
+                }
             }
+            powerStats.sampleBusyUs += esp_timer_get_time() - captureUs;
+        }
+        powerStats.wakes++;
+        
+        if (wakeNetwork || (sampled && POWER_MODE != POWER_ACTIVE)) {
+            xTaskNotifyGive(mqttTaskHandle);
         }
         
-        // Wait for next sampling period
-        vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(SAMPLING_FREQUENCY_MS));
+        // Wait for next sampling period (never shorter than one trigger round)
+        uint32_t periodMs = sampler.periodMs > sonarRoundMs() ? sampler.periodMs : sonarRoundMs();
+        vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(periodMs));
+    }
+}
+
+/**
+ * Publish and record how long the call took
+ */
+bool timedPublish(const char* topic, const uint8_t* payload, unsigned int length, bool retained = false) {
+    uint64_t startUs = esp_timer_get_time();
+    bool ok = mqttClient.publish(topic, payload, length, retained);
+    recordLatency(publishLatency, (uint32_t)(esp_timer_get_time() - startUs));
+    return ok;
+}
+
+bool timedPublish(const char* topic, const char* payload, bool retained = false) {
+    return timedPublish(topic, (const uint8_t*)payload, strlen(payload), retained);
+}
+
+/**
+ * Publish one alert, retained so a (re)connecting CUS gets the current state
+ * PubSubClient only publishes at QoS 0: an alert that fails is kept and
+ * retried on the next pass, superseded only by a newer alert
+ */
+bool publishAlert(const AlarmEvent& alert, uint64_t nowUs) {
+    char payload[128];
+    formatAlert(payload, sizeof(payload), alert, nowUs);
+    bool ok = timedPublish(MQTT_TOPIC_ALERT, payload, true);
+    if (ok) {
+        LOG_INFO("Alert %lu: %s -> %s", alert.seq,
+                 alarmStateName(alert.previous), alarmStateName(alert.state));
+    }
+    return ok;
+}
+
+/**
+ * Deliver queued alerts in order, each one attempted once when online
+ * An undelivered alert is retried until a newer one replaces it: by the
+ * time the link is back, older states are stale
+ */
+void forwardAlerts(bool online) {
+    AlarmEvent alert;
+    while (alertRing.pop(alert)) {
+        if (hasPendingAlert && online) {
+            publishAlert(pendingAlert, esp_timer_get_time());
+        }
+        pendingAlert = alert;
+        hasPendingAlert = true;
+    }
+    if (hasPendingAlert && online && publishAlert(pendingAlert, esp_timer_get_time())) {
+        hasPendingAlert = false;
+    }
+}
+
+/**
+ * Move samples taken while offline into the store-and-forward buffer
+ * Only channel 0 is buffered, additional channels are live-only
+ */
+void stashSamplesOffline() {
+    LevelSample sample;
+    while (sampleRing.pop(sample)) {
+        if (sample.channel == 0) {
+            offlineStore(sample);
+        }
+    }
+}
+
+/**
+ * Format samples as a backfill payload
+ * Payload: {"samples":[[seq,age_ms,level],...]}, age relative to nowUs
+ * @return Payload length (>= size means it did not fit)
+ */
+int formatBackfillPayload(char* payload, int size, const LevelSample* batch, uint32_t count, uint64_t nowUs) {
+    int len = appendf(payload, 0, size, "{\"samples\":[");
+    for (uint32_t i = 0; i < count; i++) {
+        char level[16];
+        formatLevel(level, sizeof(level), batch[i].level);
+        len = appendf(payload, len, size, "%s[%lu,%lu,%s]",
+                      i > 0 ? "," : "",
+                      (unsigned long)batch[i].seq,
+                      (unsigned long)((nowUs - batch[i].captureUs) / 1000),
+                      level);
+    }
+    return appendf(payload, len, size, "]}");
+}
+
+/**
+ * Publish one rate-limited batch of buffered samples on the backfill topic
+ */
+void forwardBackfillBatch() {
+    if (offlineSize() == 0 || millis() - lastBackfillMs < BACKFILL_INTERVAL_MS) {
+        return;
+    }
+    lastBackfillMs = millis();
+    
+    LevelSample batch[BACKFILL_BATCH_SIZE];
+    uint32_t count = offlinePeekBatch(batch, BACKFILL_BATCH_SIZE);
+    if (count == 0) {
+        return;
+    }
+    
+    char payload[MQTT_BUFFER_SIZE - 64];
+    if (formatBackfillPayload(payload, sizeof(payload), batch, count, esp_timer_get_time()) >= (int)sizeof(payload)) {
+        LOG_ERROR("Backfill batch too large, check BACKFILL_BATCH_SIZE");
+        return;
+    }
+    
+    if (timedPublish(MQTT_TOPIC_BACKFILL, payload)) {
+        offlineConsume(count);
+        if (offlineSize() == 0) {
+            LOG_INFO("Backfill complete, forwarded %lu", offlineBuffer.forwarded);
+        }
+    }
+}
+
+/**
+ * Publish the open binary batch (if any) and start a new one
+ * If the publish fails the samples go to the offline buffer and reach the
+ * CUS as backfill, like a failed text publish
+ */
+void flushTelemetryBatch() {
+    size_t size = telemetryBatchSize(telemetryBatch);
+    if (size > 0 && !timedPublish(MQTT_TOPIC_BINARY, telemetryBatch.buffer, size)) {
+        for (uint8_t i = 0; i < telemetryBatch.count; i++) {
+            offlineStore(telemetryBatch.samples[i]);
+        }
+        LOG_WARN("Binary batch publish failed, %lu samples buffered", telemetryBatch.count);
+    }
+    telemetryBatchReset(telemetryBatch);
+}
+
+/**
+ * Publish one live sample on the enabled telemetry formats
+ * Binary batches carry every sample, the text topic only what the policy lets through
+ */
+void publishLiveSample(const LevelSample& sample) {
+    if (TELEMETRY_BINARY_ENABLED && !telemetryBatchAppend(telemetryBatch, sample, millis())) {
+        flushTelemetryBatch();
+        telemetryBatchAppend(telemetryBatch, sample, millis());
+    }
+    
+    if (!TELEMETRY_TEXT_ENABLED) {
+        return;
+    }
+    
+    PublishReason reason = evaluatePublish(publishPolicy, sample.level, millis());
+    if (reason == PUBLISH_NONE) {
+        return;
+    }
+    
+    char msg[20];
+    formatLevel(msg, sizeof(msg), sample.level);
+    if (!timedPublish(MQTT_TOPIC_LEVEL, msg)) {
+        if (!TELEMETRY_BINARY_ENABLED) {
+            offlineStore(sample);  // Otherwise its binary batch carries it, buffered on failure
+        }
+    } else {
+        recordWakeToPublish(powerStats, esp_timer_get_time() - sample.captureUs);
+    }
+    
+    if (reason == PUBLISH_HEARTBEAT) {
+        LOG_INFO("Publish stats: sent %lu, suppressed %lu", publishPolicy.sent, publishPolicy.suppressed);
+    }
+}
+
+/**
+ * Publish a sample of an additional channel on its own topic
+ * Same deadband/band/heartbeat policy as channel 0, tracked per channel
+ */
+void publishChannelSample(const LevelSample& sample) {
+    if (evaluatePublish(channelPolicy[sample.channel], sample.level, millis()) == PUBLISH_NONE) {
+        return;
+    }
+    char msg[20];
+    formatLevel(msg, sizeof(msg), sample.level);
+    timedPublish(SONAR_CHANNELS[sample.channel].topic, msg);
+}
+
+/**
+ * Publish runtime diagnostics on MQTT_TOPIC_DIAG every DIAG_INTERVAL_MS
+ * Stack figures are the minimum free stack ever seen (bytes on ESP-IDF)
+ * cpu is the task's share of one core since the last publish
+ */
+void publishDiagnostics() {
+    if (millis() - lastDiagMs < DIAG_INTERVAL_MS) {
+        return;
+    }
+    lastDiagMs = millis();
+    
+    TaskHandle_t handles[DIAG_MAX_TRACKED_TASKS] = { sonarTaskHandle, mqttTaskHandle, ledTaskHandle, logTaskHandle };
+    const char* names[DIAG_MAX_TRACKED_TASKS] = { "sonar", "mqtt", "led", "log" };
+    int cpu[DIAG_MAX_TRACKED_TASKS];
+    sampleTaskCpu(handles, DIAG_MAX_TRACKED_TASKS, cpu);
+    
+    char payload[MQTT_BUFFER_SIZE - 64];
+    const int size = sizeof(payload);
+    int len = appendf(payload, 0, size, "{\"uptime_s\":%lu,\"heap_free\":%lu,\"heap_min\":%lu,\"tasks\":{",
+                      millis() / 1000, (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap());
+    for (int i = 0; i < DIAG_MAX_TRACKED_TASKS; i++) {
+        len = appendf(payload, len, size, "%s\"%s\":{\"stack_free\":%lu,\"cpu\":%d}", i > 0 ? "," : "",
+                      names[i], (unsigned long)uxTaskGetStackHighWaterMark(handles[i]), cpu[i]);
     }
+    len = appendf(payload, len, size, "},");
+    len = appendHistogram(payload, len, size, "acq_us", acquisitionLatency);
+    len = appendf(payload, len, size, ",");
+    len = appendHistogram(payload, len, size, "pub_us", publishLatency);
+    len = appendf(payload, len, size,
+                  ",\"reconnect_attempts\":%lu,\"recoveries\":%lu,\"recover_last_ms\":%lu,\"recover_max_ms\":%lu"
+                  ",\"ring_overflows\":%lu,\"offline_pending\":%lu,\"offline_dropped\":%lu"
+                  ",\"pub_sent\":%lu,\"pub_suppressed\":%lu,\"period_ms\":%lu"
+                  ",\"air_deci_c\":%d,\"sound_cm_s\":%lu,\"log_dropped\":%lu,",
+                  (unsigned long)reconnectBackoff.attempts, (unsigned long)reconnectBackoff.recoveries,
+                  reconnectBackoff.lastRecoveryMs,
+                  reconnectBackoff.maxRecoveryMs, (unsigned long)sampleRing.overflowCount(),
+                  (unsigned long)offlineSize(), (unsigned long)offlineBuffer.dropped,
+                  (unsigned long)publishPolicy.sent, (unsigned long)publishPolicy.suppressed,
+                  (unsigned long)sampler.periodMs,
+                  (int)echoConversion.tempDeciC, (unsigned long)echoConversion.speedCmPerS,
+                  (unsigned long)logRing.overflowCount());
+    len = appendPowerStats(payload, len, size, powerStats, esp_timer_get_time());
+    len = appendf(payload, len, size, "}");
+    
+    if (len >= size) {
+        LOG_WARN("Diagnostics payload truncated, not sent");
+        return;
+    }
+    timedPublish(MQTT_TOPIC_DIAG, payload);
+}
+
+/**
+ * Sleep until the MQTT task has something to do
+ * sonarTask wakes it early for alerts. In low-power mode it otherwise blocks
+ * until a sample is handed over (or the keepalive is due) so the core can
+ * light-sleep; a pending backlog keeps the short poll so backfill is not slowed down
+ */
+void waitForNetworkWork() {
+    bool poll = POWER_MODE == POWER_ACTIVE || offlineSize() > 0;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(poll ? 100 : MQTT_IDLE_WAIT_MS));
 }
 
 /**
@@ -53,58 +391,98 @@ void sonarTask(void* parameter) {
 void mqttTask(void* parameter) {
     setupWiFi();
     setupMQTT();
+    setupOfflineBuffer();
+    
+    // Boot counts as an outage so the first connect is timed too
+    backoffStartOutage(reconnectBackoff, millis());
+    uint32_t reportedOverflows = 0;
     
     for (;;) {
+        if (currentState != STATE_CONNECTED) {
+            stashSamplesOffline();
+            forwardAlerts(false);
+        }
+        
         switch (currentState) {
             case STATE_INITIALIZING:
             case STATE_CONNECTING_WIFI:
                 if (WiFi.status() != WL_CONNECTED) {
-                    // WiFi connecting...
-                    vTaskDelay(pdMS_TO_TICKS(500));
+                    // WiFi connecting (the driver retries on its own)...
+                    vTaskDelay(pdMS_TO_TICKS(100));
                 } else {
-                    Serial.println("\nWiFi connected!");
-                    Serial.print("IP address: ");
-                    Serial.println(WiFi.localIP());
+                    IPAddress ip = WiFi.localIP();
+                    LOG_INFO("WiFi connected! IP address: %lu.%lu.%lu.%lu", ip[0], ip[1], ip[2], ip[3]);
                     handleStateTransition(STATE_CONNECTING_MQTT);
                 }
                 break;
                 
             case STATE_CONNECTING_MQTT:
-                if (mqttClient.connect(MQTT_CLIENT_ID)) {
-                    Serial.println("MQTT connected!");
+                if (WiFi.status() != WL_CONNECTED) {
+                    handleStateTransition(STATE_CONNECTING_WIFI);
+                } else if (!backoffAttemptDue(reconnectBackoff, millis())) {
+                    // Waiting for the next slot, keep buffering samples meanwhile
+                    vTaskDelay(pdMS_TO_TICKS(100));
+                } else if (mqttClient.connect(MQTT_CLIENT_ID)) {
+                    unsigned long recoveryMs = backoffSucceeded(reconnectBackoff, millis());
+                    LOG_INFO("MQTT connected! Recovered in %lu ms", recoveryMs);
+                    resetPublishPolicy(publishPolicy);
+                    for (int ch = 0; ch < SONAR_CHANNEL_COUNT; ch++) {
+                        resetPublishPolicy(channelPolicy[ch]);
+                    }
                     handleStateTransition(STATE_CONNECTED);
                 } else {
-                    Serial.print("MQTT connection failed, rc=");
-                    Serial.println(mqttClient.state());
-                    vTaskDelay(pdMS_TO_TICKS(RECONNECT_DELAY_MS));
+                    unsigned long retryMs = backoffFailed(reconnectBackoff, millis());
+                    LOG_WARN("MQTT connection failed, rc=%ld, retry in %lu ms", mqttClient.state(), retryMs);
                 }
                 break;
                 
             case STATE_CONNECTED:
                 if (!mqttClient.connected()) {
-                    Serial.println("MQTT disconnected!");
+                    LOG_WARN("MQTT disconnected!");
                     handleStateTransition(STATE_NETWORK_ERROR);
                 } else {
+                    uint64_t busyStartUs = esp_timer_get_time();
                     mqttClient.loop();
                     
-                    // Publish water level data (plain number format for CUS compatibility)
-                    if (latestWaterLevel > 0) {
-                        char msg[20];
-                        snprintf(msg, sizeof(msg), "%.2f", latestWaterLevel);
-                        mqttClient.publish(MQTT_TOPIC_LEVEL, msg);
+                    // Alerts go out before any queued sample
+                    forwardAlerts(true);
+                    
+                    // Publish new samples
+                    LevelSample sample;
+                    while (sampleRing.pop(sample)) {
+                        if (sample.channel == 0) {
+                            publishLiveSample(sample);
+                        } else {
+                            publishChannelSample(sample);
+                        }
+                    }
+                    
+                    if (TELEMETRY_BINARY_ENABLED && telemetryBatchDue(telemetryBatch, millis())) {
+                        flushTelemetryBatch();
                     }
+                    
+                    // Live samples first, then at most one backlog batch
+                    forwardBackfillBatch();
+                    publishDiagnostics();
+                    
+                    if (sampleRing.overflowCount() != reportedOverflows) {
+                        reportedOverflows = sampleRing.overflowCount();
+                        LOG_WARN("Sample ring overflows: %lu", reportedOverflows);
+                    }
+                    powerStats.networkBusyUs += esp_timer_get_time() - busyStartUs;
                 }
-                vTaskDelay(pdMS_TO_TICKS(100));
+                waitForNetworkWork();
                 break;
                 
             case STATE_NETWORK_ERROR:
-                Serial.println("Attempting to recover from network error...");
+                // No fixed wait here: the first retry is immediate, later ones back off
+                LOG_INFO("Attempting to recover from network error...");
+                backoffStartOutage(reconnectBackoff, millis());
                 if (WiFi.status() != WL_CONNECTED) {
                     handleStateTransition(STATE_CONNECTING_WIFI);
                 } else {
                     handleStateTransition(STATE_CONNECTING_MQTT);
                 }
-                vTaskDelay(pdMS_TO_TICKS(RECONNECT_DELAY_MS));
                 break;
         }
     }
@@ -113,6 +491,7 @@ void mqttTask(void* parameter) {
 /**
  * LED Task: Controls LED indicators based on system state
  * Requirement: Green ON + Red OFF = OK, Red ON + Green OFF = Error
+ * Woken by state transitions; only active mode also refreshes periodically
  */
 void ledTask(void* parameter) {
     for (;;) {
@@ -136,16 +515,107 @@ void ledTask(void* parameter) {
                 break;
         }
         
-        vTaskDelay(pdMS_TO_TICKS(500));
+        ulTaskNotifyTake(pdTRUE, POWER_MODE == POWER_ACTIVE ? pdMS_TO_TICKS(500) : portMAX_DELAY);
     }
 }
 
+// ==================== DEEP SLEEP CYCLE ====================
+
+/**
+ * Bring the radio up, publish the RTC batch and shut the radio down
+ * Older samples go out on the backfill topic, the newest one live
+ * @return true if the batch was delivered
+ */
+bool deepSleepPublishBatch() {
+    rtcState.stats.radioWakes++;
+    setupWiFi();
+    setupMQTT();
+    
+    unsigned long startMs = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - startMs < DEEP_SLEEP_RADIO_TIMEOUT_MS) {
+        delay(10);
+    }
+    bool delivered = WiFi.status() == WL_CONNECTED && mqttClient.connect(MQTT_CLIENT_ID);
+    
+    if (delivered) {
+        uint64_t nowUs = rtcState.timelineUs + esp_timer_get_time();
+        if (rtcState.hasPendingAlert && publishAlert(rtcState.pendingAlert, nowUs)) {
+            rtcState.hasPendingAlert = false;
+        }
+        
+        uint32_t older = rtcState.count - 1;
+        char payload[MQTT_BUFFER_SIZE - 64];
+        if (older > 0 && formatBackfillPayload(payload, sizeof(payload), rtcState.samples, older, nowUs) < (int)sizeof(payload)) {
+            delivered = timedPublish(MQTT_TOPIC_BACKFILL, payload);
+        }
+        
+        const LevelSample& newest = rtcState.samples[older];
+        formatLevel(payload, sizeof(payload), newest.level);
+        delivered = delivered && timedPublish(MQTT_TOPIC_LEVEL, payload);
+        
+        if (delivered) {
+            recordWakeToPublish(rtcState.stats, esp_timer_get_time());
+            rtcState.count = 0;
+            
+            int len = appendf(payload, 0, sizeof(payload), "{\"dropped\":%lu,", (unsigned long)rtcState.dropped);
+            len = appendPowerStats(payload, len, sizeof(payload), rtcState.stats, nowUs);
+            len = appendf(payload, len, sizeof(payload), "}");
+            if (len < (int)sizeof(payload)) {
+                timedPublish(MQTT_TOPIC_DIAG, payload);
+            }
+        }
+        mqttClient.disconnect();
+    }
+    
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+    return delivered;
+}
+
+/**
+ * One deep-sleep wake: sample, batch in RTC memory, publish when the batch
+ * is full or the alarm state changed, then sleep again
+ * Never returns (the next wake starts over from setup())
+ */
+void deepSleepCycle() {
+    setupDeepSleepState();
+    rtcState.stats.wakes++;
+    
+    uint32_t echoNs = captureEchoNs();
+    int32_t waterLevel = echoToLevel(echoConversion, echoNs);
+    bool alarmChanged = false;
+    if (waterLevel > 0) {
+        deepSleepStore(waterLevel, echoNs);
+        uint64_t nowUs = rtcState.timelineUs + esp_timer_get_time();
+        AlarmEvent alert;
+        alarmChanged = evaluateAlarm(rtcState.alarm, waterLevel, (unsigned long)(nowUs / 1000), nowUs, alert);
+        if (alarmChanged && ALARM_ENGINE_ENABLED) {
+            rtcState.pendingAlert = alert;
+            rtcState.hasPendingAlert = true;
+        }
+        LOG_INFO("Water Level: %lu.%02lu cm (batched %lu)",
+                 waterLevel / LEVEL_UNITS_PER_CM, waterLevel % LEVEL_UNITS_PER_CM, rtcState.count);
+    }
+    
+    uint64_t radioStartUs = esp_timer_get_time();
+    bool radioDue = rtcState.count >= DEEP_SLEEP_BATCH_SAMPLES || alarmChanged || rtcState.hasPendingAlert;
+    if (radioDue && rtcState.count > 0) {
+        if (!deepSleepPublishBatch()) {
+            LOG_WARN("Radio wake failed, keeping the batch");
+        }
+    }
+    uint64_t radioUs = esp_timer_get_time() - radioStartUs;
+    rtcState.stats.networkBusyUs += radioUs;
+    rtcState.stats.sampleBusyUs += esp_timer_get_time() - radioUs;
+    
+    deepSleepUntilNextSample();
+}
+
 /**
  * Setup hardware pins
  */
 void setupPins() {
-    pinMode(SONAR_TRIG_PIN, OUTPUT);
-    pinMode(SONAR_ECHO_PIN, INPUT);
+    setupSonarCapture();
     pinMode(LED_GREEN_PIN, OUTPUT);
     pinMode(LED_RED_PIN, OUTPUT);
     
@@ -159,22 +629,24 @@ void setupPins() {
  * Create all FreeRTOS tasks
  */
 void createTasks() {
-    xTaskCreate(
+    xTaskCreatePinnedToCore(
         sonarTask,          // Task function
         "SonarTask",        // Task name
         4096,               // Stack size (bytes)
         NULL,               // Task parameter
         2,                  // Priority
-        &sonarTaskHandle    // Task handle
+        &sonarTaskHandle,   // Task handle
+        ACQUISITION_CORE    // Same core as the echo ISR
     );
     
-    xTaskCreate(
+    xTaskCreatePinnedToCore(
         mqttTask,
         "MQTTTask",
         8192,               // Larger stack for network operations
         NULL,
         1,                  // Lower priority
-        &mqttTaskHandle
+        &mqttTaskHandle,
+        NETWORK_CORE        // Next to the WiFi/lwIP tasks
     );
     
     xTaskCreate(
@@ -186,6 +658,16 @@ void createTasks() {
         &ledTaskHandle
     );
     
+    xTaskCreatePinnedToCore(
+        logTask,
+        "LogTask",
+        3072,               // Formats the records
+        NULL,
+        tskIDLE_PRIORITY,   // Only runs when nothing else has work
+        &logTaskHandle,
+        NETWORK_CORE        // Away from the echo ISR core
+    );
+    
     Serial.println("FreeRTOS tasks created successfully");
 }
 
@@ -0,0 +1,114 @@
+/**
+ * TMS Binary Telemetry
+ * Versioned, packed little-endian batch payload for MQTT_TOPIC_BINARY
+ *
+ * Layout (version 1):
+ *   offset  size  field
+ *   0       1     version (TELEMETRY_VERSION)
+ *   1       1     sample count N (>= 1)
+ *   2       2     device id
+ *   4       4     seq of the first sample
+ *   8       4     capture time of the first sample (ms, device uptime)
+ *   12      2     level of the first sample (0.01 cm)
+ *   14      4*(N-1) per following sample: u16 time delta (ms), i16 level delta (0.01 cm)
+ * Samples in a batch have consecutive seq numbers, so a seq gap between
+ * batches means samples were lost.
+ */
+
+#ifndef TMS_TELEMETRY_H
+#define TMS_TELEMETRY_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "SampleRing.h"
+
+// ==================== BATCH STATE ====================
+
+const uint8_t TELEMETRY_VERSION = 1;
+const size_t TELEMETRY_HEADER_SIZE = 14;
+const size_t TELEMETRY_SAMPLE_SIZE = 4;
+
+struct TelemetryBatch {
+    uint8_t buffer[TELEMETRY_HEADER_SIZE + TELEMETRY_SAMPLE_SIZE * (TELEMETRY_BATCH_MAX_SAMPLES - 1)];
+    LevelSample samples[TELEMETRY_BATCH_MAX_SAMPLES];  // As appended: buffered offline if the publish fails
+    uint8_t count;
+    uint32_t nextSeq;
+    uint32_t lastMs;
+    int32_t lastLevel;
+    unsigned long openedAtMs;
+};
+
+// ==================== ENCODING ====================
+
+void putU16LE(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+void putU32LE(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * Size of the encoded batch in bytes (0 if empty)
+ */
+size_t telemetryBatchSize(const TelemetryBatch& batch) {
+    return batch.count == 0 ? 0 : TELEMETRY_HEADER_SIZE + TELEMETRY_SAMPLE_SIZE * (batch.count - 1);
+}
+
+void telemetryBatchReset(TelemetryBatch& batch) {
+    batch.count = 0;
+}
+
+/**
+ * Append a sample to the batch
+ * @return false if it cannot be encoded in this batch (full, seq gap or
+ *         delta out of range); flush and append again to start a new batch
+ */
+bool telemetryBatchAppend(TelemetryBatch& batch, const LevelSample& sample, unsigned long nowMs) {
+    uint32_t timeMs = (uint32_t)(sample.captureUs / 1000);
+    int32_t level = sample.level;  // Level units are already 0.01 cm
+    
+    if (batch.count == 0) {
+        batch.buffer[0] = TELEMETRY_VERSION;
+        batch.buffer[1] = 1;
+        putU16LE(&batch.buffer[2], DEVICE_ID);
+        putU32LE(&batch.buffer[4], sample.seq);
+        putU32LE(&batch.buffer[8], timeMs);
+        putU16LE(&batch.buffer[12], (uint16_t)constrain(level, 0, 65535));
+        batch.samples[0] = sample;
+        batch.count = 1;
+        batch.openedAtMs = nowMs;
+    } else {
+        uint32_t dt = timeMs - batch.lastMs;
+        int32_t dLevel = level - batch.lastLevel;
+        
+        if (batch.count >= TELEMETRY_BATCH_MAX_SAMPLES || sample.seq != batch.nextSeq ||
+            dt > 0xFFFF || dLevel < -32768 || dLevel > 32767) {
+            return false;
+        }
+        
+        uint8_t* p = &batch.buffer[telemetryBatchSize(batch)];
+        putU16LE(p, (uint16_t)dt);
+        putU16LE(p + 2, (uint16_t)(int16_t)dLevel);
+        batch.samples[batch.count++] = sample;
+        batch.buffer[1] = batch.count;
+    }
+    
+    batch.nextSeq = sample.seq + 1;
+    batch.lastMs = timeMs;
+    batch.lastLevel = level;
+    return true;
+}
+
+/**
+ * True when the batch has been open for a whole window
+ */
+bool telemetryBatchDue(const TelemetryBatch& batch, unsigned long nowMs) {
+    return batch.count > 0 && nowMs - batch.openedAtMs >= TELEMETRY_BATCH_WINDOW_MS;
+}
+
+#endif // TMS_TELEMETRY_H
@@ -0,0 +1,136 @@
+/**
+ * WCS Hot Path Benchmark (host)
+ * Times the per-message and per-pass work of the sketch on the native HAL:
+ * command parsing (JSON line and binary frame), status serialization,
+ * servo mapping and motion profile, LCD render and flush.
+ * Serial output goes to a byte-counting sink and the clock is virtual, so
+ * only the firmware code itself is measured.
+ * Run with: pio run -e bench -t exec
+ * or: g++ -std=gnu++17 -O2 -DNATIVE_BUILD -I../hal/native -Isrc bench/hotpath_bench.cpp
+ * Options (--json, --out, --baseline, ...): see hal/native/SimBench.h
+ */
+
+#define SIM_SYSTEM
+#include "main.cpp"
+#include <SimBench.h>
+
+// ==================== INPUTS ====================
+
+const char* const JSON_SET_VALVE = "{\"cmd\":\"set_valve\",\"value\":50,\"id\":1234}\n";
+const char* const JSON_LEVEL = "{\"cmd\":\"level\",\"value\":3012}\n";
+
+const int FRAME_COUNT = 256;  // One per sequence number, so none looks lost
+
+struct EncodedFrame {
+    uint8_t data[FRAME_MAX_ENCODED + 1];
+    uint8_t length;
+};
+
+EncodedFrame setValveFrames[FRAME_COUNT];
+uint32_t txSinkBytes = 0;
+
+/**
+ * SET_VALVE frames as the CUS sends them (COBS, trailing 0x00)
+ */
+void buildSetValveFrames() {
+    for (int seq = 0; seq < FRAME_COUNT; seq++) {
+        uint8_t raw[FRAME_MAX_SIZE] = { OP_SET_VALVE, (uint8_t)seq, (uint8_t)(seq % 2 ? 25 : 75), 0xD2, 0x04 };
+        uint8_t size = FRAME_HEADER_SIZE + 3;
+        uint16_t crc = crc16(raw, size);
+        raw[size++] = crc & 0xFF;
+        raw[size++] = crc >> 8;
+
+        EncodedFrame& frame = setValveFrames[seq];
+        frame.length = cobsEncode(raw, size, frame.data);
+        frame.data[frame.length++] = 0;
+    }
+}
+
+/**
+ * Feed a JSON line byte by byte, as handleSerialInput does
+ */
+void feedLine(const char* text) {
+    for (const char* c = text; *c; c++) {
+        if (assembleLine(serialLine, *c)) {
+            processSerialCommand(serialLine.buffer);
+            serialLine.length = 0;
+        }
+    }
+}
+
+// ==================== BENCHMARKS ====================
+
+void registerBenchmarks() {
+    sim::benchRegister("serial/json_set_valve", [] {
+        feedLine(JSON_SET_VALVE);  // Parse, apply and ack
+    });
+    sim::benchRegister("serial/json_level", [] {
+        feedLine(JSON_LEVEL);
+    });
+    sim::benchRegister("serial/frame_set_valve", [] {
+        static uint8_t seq = 0;
+        const EncodedFrame& frame = setValveFrames[seq++];
+        for (uint8_t i = 0; i < frame.length; i++) {
+            uint8_t length = assembleFrame(serialFrame, frame.data[i]);
+            if (length > 0) {
+                processSerialFrame(serialFrame.buffer, length);
+            }
+        }
+    });
+
+    sim::benchRegister("status/json", [] {
+        linkProtocol = LINK_JSON;
+        sendStatusToSerial();
+    });
+    sim::benchRegister("status/binary", [] {
+        linkProtocol = LINK_BINARY;
+        sendStatusToSerial();
+        linkProtocol = LINK_JSON;
+    });
+
+    sim::benchRegister("servo/percentage_to_angle", [] {
+        static int percentage = 0;
+        sim::benchKeep(percentageToAngle(percentage));
+        percentage = percentage < 100 ? percentage + 1 : 0;
+    });
+    sim::benchRegister("servo/motion_step", [] {
+        // One VALVE_STEP_MS pass, reversing the target once the valve is there
+        sim::Clock& clock = sim::board().clock;
+        clock.advanceTo(clock.micros() + VALVE_STEP_MS * 1000UL);
+        if (currentValvePercentage == commandedValvePercentage()) {
+            setValvePercentage(commandedValvePercentage() == 100 ? 0 : 100);
+        }
+        valveMotionStep();
+    });
+
+    sim::benchRegister("lcd/render", [] {
+        static bool moving = false;
+        currentValvePercentage = moving ? 40 : 75;
+        moving = !moving;
+        updateLCD();
+    });
+    sim::benchRegister("lcd/render_flush", [] {
+        static bool moving = false;
+        currentValvePercentage = moving ? 40 : 75;
+        moving = !moving;
+        updateLCD();
+        lcdFlushStep(2 * LCD_CELLS);  // Whole diff in one call
+    });
+}
+
+int main(int argc, char** argv) {
+    sim::Board& board = sim::board();
+    board.clock.setVirtual(true, 0);
+    board.uart.onTx = [](const uint8_t*, size_t length) {
+        txSinkBytes += length;
+    };
+
+    setup();
+    handleModeTransition(MODE_AUTOMATIC);  // Valve commands are only applied once connected
+    buildSetValveFrames();
+    registerBenchmarks();
+
+    int result = sim::benchMain(argc, argv, "wcs");
+    sim::benchKeep(txSinkBytes);
+    return result;
+}
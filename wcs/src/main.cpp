@@ -2,13 +2,12 @@
  * WCS - Water Channel Subsystem
  * Hardware: Arduino UNO
  * Purpose: Control water valve and provide local operator interface
- * Architecture: FSM-based with no blocking delays
+ * Architecture: FSM-based, cooperative task table (task/Scheduler.h), no blocking delays
  */
 
 #include <Arduino.h>
 #include <Servo.h>
 #include <LiquidCrystal_I2C.h>
-#include <ArduinoJson.h>
 
 // Include task headers
 #include "task/Config.h"
@@ -16,8 +15,10 @@
 #include "task/Input.h"
 #include "task/ServoControl.h"
 #include "task/Display.h"
+#include "task/LocalControl.h"
 #include "task/SerialComm.h"
 #include "task/Logic.h"
+#include "task/Scheduler.h"
 
 // ==================== GLOBAL OBJECTS ====================
 Servo valveServo;
@@ -36,14 +37,26 @@ bool stableButtonState = HIGH;
 unsigned long lastButtonDebounceTime = 0;
 
 // Potentiometer state
-int lastPotValue = -1;
+int lastPotPercentage = -1;     // Last percentage past the hysteresis, -1 = none yet
 unsigned long ignorePotUntil = 0;
 
 // Timing variables
-unsigned long lastLCDUpdate = 0;
-unsigned long lastSerialUpdate = 0;
 unsigned long lastCUSMessageTime = 0;
 
+// ==================== TASK TABLE ====================
+// Run in this order on every pass (see Scheduler.h); budgets are for the Uno
+SchedulerTask schedulerTasks[TASK_COUNT] = {
+    // name       function              period (ms)               budget (us)
+    { "serial",   handleSerialInput,    0,                        2000 },  // One message per pass
+    { "button",   handleButtonPress,    0,                        200 },
+    { "fsm",      updateFSM,            0,                        400 },   // analogRead ~110 us
+    { "valve",    valveMotionStep,      VALVE_STEP_MS,            500 },
+    { "lcd",      updateLCD,            LCD_UPDATE_INTERVAL_MS,   1500 },  // snprintf into RAM only
+    { "lcdflush", flushLCD,             0,                        2500 },  // LCD_MAX_OPS_PER_LOOP I2C writes
+    { "status",   updateStatusReport,   0,                        1000 },  // On change + keepalive
+    { "report",   sendSchedulerReport,  SCHED_REPORT_INTERVAL_MS, 1000 }
+};
+
 // ==================== SETUP ====================
 void setup() {
     setupSerial();
@@ -55,38 +68,30 @@ void setup() {
     setupLCD();
     
     // Initial display
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print("WCS Ready");
-    lcd.setCursor(0, 1);
-    lcd.print("Mode: UNCONN");
+    lcdSetLine(0, "WCS Ready");
+    lcdSetLine(1, "Mode: UNCONN");
+    lcdFlushStep(2 * LCD_CELLS);
     
     delay(1000);
     
     Serial.println("Initialization complete");
     Serial.println("Waiting for CUS connection...");
+    
+    schedulerStart();
 }
 
 // ==================== MAIN LOOP ====================
 void loop() {
-    // Non-blocking FSM update
-    updateFSM();
-    
-    // Handle button input
-    handleButtonPress();
-    
-    // Handle serial communication
-    handleSerialInput();
-    
-    // Update LCD periodically
-    if (millis() - lastLCDUpdate >= LCD_UPDATE_INTERVAL_MS) {
-        updateLCD();
-        lastLCDUpdate = millis();
-    }
-    
-    // Send status to CUS periodically
-    if (millis() - lastSerialUpdate >= SERIAL_UPDATE_INTERVAL_MS) {
-        sendStatusToSerial();
-        lastSerialUpdate = millis();
-    }
+    // One pass over the task table: inputs, FSM, valve, LCD, status
+    schedulerRun();
+}
+
+#if defined(NATIVE_BUILD) && !defined(SIM_SYSTEM)
+// ==================== NATIVE ENTRY POINT ====================
+// The whole-system simulator (sim/) links the sketch with its own main()
+#include <SimMain.h>
+
+int main() {
+    return sim::run(setup, loop);
 }
+#endif
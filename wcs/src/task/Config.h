@@ -11,22 +11,43 @@ const int SERVO_PIN = 9;
 const int POTENTIOMETER_PIN = A0;
 const int BUTTON_PIN = 2;
 
+// ==================== POTENTIOMETER CONFIGURATION ====================
+const uint8_t POT_OVERSAMPLE_SHIFT = 4;   // 16 samples per block (+2 bits of resolution)
+const uint8_t POT_FILTER_SHIFT = 2;       // IIR weight 1/4 per block (~7 ms time constant)
+const int POT_HYSTERESIS_TENTHS = 3;      // 0.3 % beyond the rounding band before the percentage moves
+
 // ==================== LCD CONFIGURATION ====================
 const int LCD_ADDRESS = 0x27;
 const int LCD_COLS = 16;
 const int LCD_ROWS = 2;
+const uint8_t LCD_MAX_OPS_PER_LOOP = 4;  // Bus operations per loop(), bounds the I2C time (~2 ms)
 
 // ==================== TIMING CONFIGURATION ====================
 const unsigned long BUTTON_DEBOUNCE_MS = 50;
 const unsigned long LCD_UPDATE_INTERVAL_MS = 500;
-const unsigned long SERIAL_UPDATE_INTERVAL_MS = 500;
+const unsigned long SERIAL_KEEPALIVE_MS = 2000;           // Status without changes (below the CUS link timeout)
+const unsigned long SERIAL_STATUS_MIN_INTERVAL_MS = 100;  // Spacing of change-driven status while the valve moves
 const unsigned long CUS_TIMEOUT_MS = 5000;  // 5 seconds without CUS message -> UNCONNECTED
 
+// ==================== SCHEDULER CONFIGURATION ====================
+const unsigned long SCHED_LOOP_BUDGET_US = 5000;      // Longest acceptable loop() pass = input latency bound
+const unsigned long SCHED_REPORT_INTERVAL_MS = 1000;  // One task timing report per interval (round robin)
+
+// ==================== LOCAL CONTROL CONFIGURATION ====================
+const unsigned long LOCAL_LEVEL_STALE_MS = 10000;   // Back to AUTOMATIC without level samples (TMS max period 4 s)
+const unsigned long LOCAL_CUS_OVERRIDE_MS = 5000;   // Local policy suspended after a CUS valve command
+
 // ==================== VALVE CONFIGURATION ====================
 const int VALVE_MIN_ANGLE = 0;    // 0% = Closed
 const int VALVE_MAX_ANGLE = 90;   // 100% = Fully open
+const int VALVE_SLEW_RATE_PCT_S = 50;          // Top speed: 0 -> 100% in about 2.5 s
+const int VALVE_ACCEL_PCT_S2 = 100;            // Speed change limit (limits water hammer)
+const unsigned long VALVE_STEP_MS = 20;        // Motion update period (servo frame rate)
 
 // ==================== SERIAL CONFIGURATION ====================
 const unsigned long SERIAL_BAUD = 9600;
+const int SERIAL_LINE_BUFFER_SIZE = 64;  // Longest command line + 1 (static, no String)
+const unsigned long SERIAL_MAX_BAUD = 250000;  // Highest rate accepted in a CUS hello (0% error at 16 MHz)
+const uint8_t SERIAL_FRAME_MAX_PAYLOAD = 8;    // Binary frame payload limit
 
 #endif // WCS_CONFIG_H
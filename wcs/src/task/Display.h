@@ -1,6 +1,7 @@
 /**
  * WCS Display Functions
- * LCD display management
+ * LCD display management through a shadow framebuffer: rendering only
+ * touches RAM, and the changed characters reach the LCD a few at a time
  */
 
 #ifndef WCS_DISPLAY_H
@@ -15,8 +16,75 @@
 // Global LCD object
 extern LiquidCrystal_I2C lcd;
 
-// Timing
-extern unsigned long lastLCDUpdate;
+// ==================== FRAMEBUFFER ====================
+
+const uint8_t LCD_CELLS = LCD_ROWS * LCD_COLS;
+
+char lcdFrame[LCD_ROWS][LCD_COLS];   // Wanted content (RAM only)
+char lcdShown[LCD_ROWS][LCD_COLS];   // Content on the LCD
+uint8_t lcdScanPos = 0;              // Next cell compared by lcdFlushStep
+int8_t lcdCursorPos = -1;            // LCD address counter as a cell index, -1 = unknown
+bool lcdPending = false;             // lcdFrame may differ from lcdShown
+
+/**
+ * Write a whole line into the framebuffer, padded with spaces
+ */
+void lcdSetLine(uint8_t row, const char* text) {
+    for (uint8_t col = 0; col < LCD_COLS; col++) {
+        char c = *text ? *text++ : ' ';
+        if (lcdFrame[row][col] != c) {
+            lcdFrame[row][col] = c;
+            lcdPending = true;
+        }
+    }
+}
+
+/**
+ * Send changed cells to the LCD, at most maxOps bus operations per call
+ * A character write and a cursor move count as one operation each
+ * (~0.5 ms over I2C at 100 kHz); consecutive changed cells on a line
+ * share one cursor move thanks to the LCD address auto-increment
+ */
+void lcdFlushStep(uint8_t maxOps) {
+    if (!lcdPending) {
+        return;
+    }
+    
+    uint8_t ops = 0;
+    uint8_t clean = 0;   // Consecutive cells found unchanged
+    while (clean < LCD_CELLS) {
+        uint8_t pos = lcdScanPos;
+        uint8_t row = pos / LCD_COLS;
+        uint8_t col = pos % LCD_COLS;
+        
+        if (lcdFrame[row][col] != lcdShown[row][col]) {
+            uint8_t needed = (lcdCursorPos == pos) ? 1 : 2;
+            if (ops + needed > maxOps) {
+                return;  // Resume from this cell on the next call
+            }
+            if (needed == 2) {
+                lcd.setCursor(col, row);
+            }
+            lcd.write((uint8_t)lcdFrame[row][col]);
+            lcdShown[row][col] = lcdFrame[row][col];
+            ops += needed;
+            clean = 0;
+            // The address counter does not wrap to the next line
+            lcdCursorPos = (col + 1 < LCD_COLS) ? pos + 1 : -1;
+        } else {
+            clean++;
+        }
+        lcdScanPos = (pos + 1) % LCD_CELLS;
+    }
+    lcdPending = false;
+}
+
+/**
+ * Scheduler task: bounded LCD flush for one pass
+ */
+void flushLCD() {
+    lcdFlushStep(LCD_MAX_OPS_PER_LOOP);
+}
 
 // ==================== DISPLAY FUNCTIONS ====================
 
@@ -27,35 +95,45 @@ void setupLCD() {
     lcd.init();
     lcd.backlight();
     lcd.clear();
+    memset(lcdShown, ' ', sizeof(lcdShown));
+    memset(lcdFrame, ' ', sizeof(lcdFrame));
+    lcdCursorPos = 0;
     Serial.println("LCD initialized");
 }
 
 /**
  * Update LCD display with current mode and valve status
+ * Only renders into the framebuffer; lcdFlushStep sends the changes
  */
 void updateLCD() {
-    lcd.clear();
+    char line[LCD_COLS + 1];
     
     // Line 1: Mode
-    lcd.setCursor(0, 0);
-    lcd.print("Mode: ");
+    const char* mode = "UNCONN";
     switch (currentMode) {
         case MODE_UNCONNECTED:
-            lcd.print("UNCONN");
+            mode = "UNCONN";
             break;
         case MODE_AUTOMATIC:
-            lcd.print("AUTO");
+            mode = "AUTO";
             break;
         case MODE_MANUAL:
-            lcd.print("MANUAL");
+            mode = "MANUAL";
+            break;
+        case MODE_LOCAL:
+            mode = "LOCAL";
             break;
     }
+    snprintf(line, sizeof(line), "Mode: %s", mode);
+    lcdSetLine(0, line);
     
-    // Line 2: Valve opening
-    lcd.setCursor(0, 1);
-    lcd.print("Valve: ");
-    lcd.print(currentValvePercentage);
-    lcd.print("%");
+    // Line 2: Valve opening, and where it is going while it moves
+    if (currentValvePercentage != commandedValvePercentage()) {
+        snprintf(line, sizeof(line), "Valve: %d%%>%d%%", currentValvePercentage, commandedValvePercentage());
+    } else {
+        snprintf(line, sizeof(line), "Valve: %d%%", currentValvePercentage);
+    }
+    lcdSetLine(1, line);
 }
 
 #endif // WCS_DISPLAY_H
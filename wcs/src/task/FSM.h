@@ -13,7 +13,8 @@
 enum SystemMode {
     MODE_UNCONNECTED,   // No connection with CUS
     MODE_AUTOMATIC,     // CUS controls valve
-    MODE_MANUAL         // Local control via potentiometer
+    MODE_MANUAL,        // Local control via potentiometer
+    MODE_LOCAL          // Automatic, threshold policy run on the WCS (LocalControl.h)
 };
 
 // Global mode variables
@@ -1,6 +1,10 @@
 /**
  * WCS Input Handling
  * Button debouncing and potentiometer reading
+ *
+ * The ADC free-runs on the potentiometer channel and its conversion-complete
+ * interrupt filters every sample, so reading the potentiometer never waits
+ * for a conversion. analogRead() must not be used while it runs.
  */
 
 #ifndef WCS_INPUT_H
@@ -23,38 +27,109 @@ extern unsigned long lastButtonDebounceTime;
  */
 void handleButtonPress();  // Forward declaration
 
+extern int lastPotPercentage;
+extern unsigned long ignorePotUntil;
+
+// ==================== POTENTIOMETER FILTER ====================
+
+const uint8_t POT_OVERSAMPLE = 1 << POT_OVERSAMPLE_SHIFT;
+const uint16_t POT_FULL_SCALE = 1023U << POT_OVERSAMPLE_SHIFT;  // Filtered value at 100%
+
+// The filter state holds the block sum << POT_FILTER_SHIFT in 16 bits
+static_assert(POT_OVERSAMPLE_SHIFT + POT_FILTER_SHIFT <= 6, "potentiometer filter overflows 16 bits");
+
+uint16_t potBlockSum = 0;        // ISR only
+uint8_t potBlockCount = 0;       // ISR only
+uint16_t potFilterState = 0;     // ISR only
+bool potFilterReady = false;     // ISR only
+volatile uint16_t potFiltered = 0;  // 0..POT_FULL_SCALE, shared with the loop
+
 /**
- * Read potentiometer value and convert to percentage
- * @return Valve percentage (0-100)
+ * Filter one ADC sample (ADC interrupt)
+ * POT_OVERSAMPLE samples are summed into one block (extra resolution),
+ * then blocks go through state += block - state / 2^POT_FILTER_SHIFT.
+ * The first block seeds the filter so it starts settled.
  */
-extern int lastPotValue;
-extern unsigned long ignorePotUntil;
+void potAdcSample(uint16_t sample) {
+    potBlockSum += sample;
+    if (++potBlockCount < POT_OVERSAMPLE) {
+        return;
+    }
+    if (potFilterReady) {
+        potFilterState = potFilterState - (potFilterState >> POT_FILTER_SHIFT) + potBlockSum;
+    } else {
+        potFilterState = potBlockSum << POT_FILTER_SHIFT;
+        potFilterReady = true;
+    }
+    potFiltered = potFilterState >> POT_FILTER_SHIFT;
+    potBlockSum = 0;
+    potBlockCount = 0;
+}
+
+#ifdef NATIVE_BUILD
+/**
+ * No ADC interrupt on the host: feed one block per read instead
+ */
+void potAdcPoll() {
+    for (uint8_t i = 0; i < POT_OVERSAMPLE; i++) {
+        potAdcSample((uint16_t)analogRead(POTENTIOMETER_PIN));
+    }
+}
+#else
+ISR(ADC_vect) {
+    potAdcSample(ADC);
+}
+#endif
+
+/**
+ * Start free-running conversions on the potentiometer channel
+ * Prescaler 128: 125 kHz ADC clock, ~9.6 k samples/s, ~600 blocks/s
+ */
+void setupPotentiometer() {
+#ifndef NATIVE_BUILD
+    ADMUX = _BV(REFS0) | ((POTENTIOMETER_PIN - A0) & 0x07);  // AVcc reference, right adjusted
+    ADCSRB = 0;                                               // Auto trigger: free running
+    ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE) |
+             _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+#endif
+}
+
+/**
+ * Filtered potentiometer position in 0.1 % (0-1000)
+ */
+int readPotentiometerTenths() {
+#ifdef NATIVE_BUILD
+    potAdcPoll();
+#endif
+    noInterrupts();
+    uint16_t filtered = potFiltered;
+    interrupts();
+    return (int)(((uint32_t)filtered * 1000 + POT_FULL_SCALE / 2) / POT_FULL_SCALE);
+}
 
 /**
  * Check if potentiometer value has changed significantly (hysteresis)
- * @return true if changed beyond threshold
+ * The position must leave the rounding band of the last percentage by
+ * more than POT_HYSTERESIS_TENTHS, so it never flips between neighbours
+ * @return true if lastPotPercentage was updated
  */
 bool hasPotentiometerChanged() {
-    int currentVal = analogRead(POTENTIOMETER_PIN);
-    // Hysteresis threshold (approx 2% of 1023)
-    const int THRESHOLD = 20; 
+    int tenths = readPotentiometerTenths();
+    int band = 5 + POT_HYSTERESIS_TENTHS;
     
-    if (abs(currentVal - lastPotValue) > THRESHOLD) {
-        lastPotValue = currentVal;
-        return true;
+    if (lastPotPercentage >= 0 && abs(tenths - lastPotPercentage * 10) < band) {
+        return false;
     }
-    return false;
+    lastPotPercentage = (tenths + 5) / 10;
+    return true;
 }
 
 /**
- * Read potentiometer value and convert to percentage
- * @return Valve percentage (0-100)
+ * Potentiometer position as a valve percentage
+ * @return Valve percentage (0-100) at the last detected change
  */
 int readPotentiometerPercentage() {
-    int rawValue = analogRead(POTENTIOMETER_PIN);
-    // Map 0-1023 to 0-100%
-    int percentage = map(rawValue, 0, 1023, 0, 100);
-    return constrain(percentage, 0, 100);
+    return lastPotPercentage < 0 ? 0 : lastPotPercentage;
 }
 
 #endif // WCS_INPUT_H
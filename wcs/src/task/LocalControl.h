@@ -0,0 +1,120 @@
+/**
+ * WCS Local Control
+ * The CUS forwards each water level sample and the L1/L2/T1 policy
+ * parameters; with both available the WCS runs the threshold policy
+ * itself (MODE_LOCAL), so the valve reacts within one loop pass of a
+ * sample instead of waiting for the CUS control loop.
+ *
+ * Policy (same as the CUS TankMonitor):
+ *   level >= L2             -> 100%
+ *   L1 < level < L2 for T1  -> 50% (valve kept as is before T1)
+ *   level <= L1             -> 0%
+ * A valve command from the CUS still wins: it suspends the local policy
+ * for LOCAL_CUS_OVERRIDE_MS.
+ */
+
+#ifndef WCS_LOCAL_CONTROL_H
+#define WCS_LOCAL_CONTROL_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "ServoControl.h"
+
+// ==================== LOCAL CONTROL STATE ====================
+
+/**
+ * Levels in 0.1 mm (TMS level units, 100 per cm)
+ */
+struct LocalControl {
+    bool hasPolicy;
+    uint16_t l1;
+    uint16_t l2;
+    uint32_t t1Ms;
+
+    bool hasLevel;
+    uint16_t level;
+    unsigned long levelMs;          // millis() of the last sample
+
+    bool aboveL1;
+    unsigned long aboveL1SinceMs;
+    unsigned long overrideUntilMs;  // CUS valve command in force until then
+};
+
+LocalControl localControl = {};
+
+// ==================== LOCAL CONTROL FUNCTIONS ====================
+
+/**
+ * Policy parameters from the CUS
+ * @return false if they are inconsistent (not applied)
+ */
+bool applyLocalPolicy(uint16_t l1, uint16_t l2, uint32_t t1Ms) {
+    if (l1 >= l2) {
+        return false;
+    }
+    localControl.hasPolicy = true;
+    localControl.l1 = l1;
+    localControl.l2 = l2;
+    localControl.t1Ms = t1Ms;
+    return true;
+}
+
+/**
+ * Level sample forwarded by the CUS
+ */
+void applyLevelSample(uint16_t level) {
+    localControl.hasLevel = true;
+    localControl.level = level;
+    localControl.levelMs = millis();
+}
+
+/**
+ * A CUS valve command suspends the local policy for a while
+ */
+void deferToCUSCommand() {
+    localControl.overrideUntilMs = millis() + LOCAL_CUS_OVERRIDE_MS;
+}
+
+/**
+ * Local control is possible: policy known and a recent level sample
+ */
+bool localControlReady() {
+    return localControl.hasPolicy && localControl.hasLevel &&
+           millis() - localControl.levelMs <= LOCAL_LEVEL_STALE_MS;
+}
+
+/**
+ * The CUS commanded the valve recently
+ */
+bool localControlOverridden() {
+    return (long)(localControl.overrideUntilMs - millis()) > 0;
+}
+
+/**
+ * Valve opening wanted by the policy for the last sample
+ * @param current Opening kept while the T1 timer runs
+ */
+int localPolicyOpening(int current) {
+    LocalControl& lc = localControl;
+
+    if (lc.level >= lc.l2) {
+        lc.aboveL1 = false;
+        return 100;
+    }
+    if (lc.level <= lc.l1) {
+        lc.aboveL1 = false;
+        return 0;
+    }
+
+    // Between L1 and L2: 50% once it has stayed there for T1
+    if (!lc.aboveL1) {
+        lc.aboveL1 = true;
+        lc.aboveL1SinceMs = lc.levelMs;
+    }
+    if (millis() - lc.aboveL1SinceMs >= lc.t1Ms) {
+        return 50;
+    }
+    return current;
+}
+
+#endif // WCS_LOCAL_CONTROL_H
@@ -12,6 +12,8 @@
 #include "Input.h"
 #include "ServoControl.h"
 #include "Display.h"
+#include "Scheduler.h"
+#include "LocalControl.h"
 
 // ==================== FSM IMPLEMENTATION ====================
 
@@ -26,11 +28,8 @@ void handleModeTransition(SystemMode newMode) {
         previousMode = currentMode;
         currentMode = newMode;
         
-        // Force LCD update on mode change
-        updateLCD();
-        
-        // Force immediate Serial update to notify CUS
-        sendStatusToSerial();
+        // Redraw the LCD later in this scheduler pass (the status task reports the change)
+        schedulerNotify(TASK_LCD_RENDER);
     }
 }
 
@@ -54,8 +53,28 @@ void updateFSM() {
             
         case MODE_AUTOMATIC:
             // In automatic mode, valve is controlled by CUS via serial
+            // Run the policy here instead as soon as the CUS forwards levels
+            if (localControlReady()) {
+                handleModeTransition(MODE_LOCAL);
+                break;
+            }
             // Apply target valve percentage received from CUS
-            if (currentValvePercentage != targetValvePercentage) {
+            if (commandedValvePercentage() != targetValvePercentage) {
+                setValvePercentage(targetValvePercentage);
+            }
+            break;
+            
+        case MODE_LOCAL:
+            // Level samples stopped: the CUS drives the valve again
+            if (!localControlReady()) {
+                handleModeTransition(MODE_AUTOMATIC);
+                break;
+            }
+            // Threshold policy on the last sample, unless the CUS just commanded the valve
+            if (!localControlOverridden()) {
+                targetValvePercentage = localPolicyOpening(targetValvePercentage);
+            }
+            if (commandedValvePercentage() != targetValvePercentage) {
                 setValvePercentage(targetValvePercentage);
             }
             break;
@@ -70,7 +89,7 @@ void updateFSM() {
             }
             // else: keep targetValvePercentage as is (it might have been set by Serial)
             
-            if (currentValvePercentage != targetValvePercentage) {
+            if (commandedValvePercentage() != targetValvePercentage) {
                 setValvePercentage(targetValvePercentage);
             }
             break;
@@ -102,8 +121,8 @@ void handleButtonPress() {
             if (stableButtonState == LOW) {
                 // Serial.println("Button pressed - toggling mode"); // REMOVED
                 
-                // Toggle between AUTOMATIC and MANUAL (ignore if UNCONNECTED)
-                if (currentMode == MODE_AUTOMATIC) {
+                // Toggle between AUTOMATIC (or LOCAL) and MANUAL (ignore if UNCONNECTED)
+                if (currentMode == MODE_AUTOMATIC || currentMode == MODE_LOCAL) {
                     handleModeTransition(MODE_MANUAL);
                 } else if (currentMode == MODE_MANUAL) {
                     handleModeTransition(MODE_AUTOMATIC);
@@ -125,6 +144,7 @@ void handleButtonPress() {
 void setupPins() {
     pinMode(BUTTON_PIN, INPUT_PULLUP);
     pinMode(POTENTIOMETER_PIN, INPUT);
+    setupPotentiometer();
     Serial.println("Pins configured");
 }
 
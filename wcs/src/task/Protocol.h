@@ -0,0 +1,196 @@
+/**
+ * WCS Binary Link Protocol
+ * Framing used with the CUS once the link has been negotiated (see SerialComm.h):
+ *   COBS( opcode u8, seq u8, payload, crc16 u16 LE ) 0x00
+ * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) covers opcode to payload.
+ * COBS removes every 0x00 from the frame, so 0x00 only ever marks a frame
+ * end and the receiver resynchronises on the next one after any error.
+ */
+
+#ifndef WCS_PROTOCOL_H
+#define WCS_PROTOCOL_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// ==================== OPCODES ====================
+
+const uint8_t LINK_PROTOCOL_VERSION = 1;
+
+// CUS -> WCS (commands with an id are answered with OP_ACK)
+const uint8_t OP_SET_VALVE = 0x01;  // u8 percentage [, u16 LE command id]
+const uint8_t OP_SET_MODE = 0x02;   // u8 mode (SystemMode order) [, u16 LE command id]
+const uint8_t OP_PING = 0x03;       // no payload, keeps the link alive
+const uint8_t OP_LEVEL = 0x04;      // u16 LE water level (0.1 mm)
+const uint8_t OP_SET_POLICY = 0x05; // u16 LE L1, u16 LE L2 (0.1 mm), u32 LE T1 ms
+
+// WCS -> CUS
+const uint8_t OP_STATUS = 0x81;     // u8 mode, u8 valve (actual), u16 LE receive errors, u8 valve commanded,
+                                    // u16 LE status seq
+const uint8_t OP_SCHED = 0x82;      // u8 task id, u16 LE task max us, u8 task overruns (saturated),
+                                    // u16 LE loop max us, u16 LE loop overruns
+const uint8_t OP_ACK = 0x83;        // u16 LE command id, u8 result, u8 applied value, u16 LE processing us
+
+// Command results (OP_ACK result, "nack" reason in JSON)
+const uint8_t CMD_OK = 0;
+const uint8_t CMD_UNCONNECTED = 1;  // Valve command before the link was up: retry
+const uint8_t CMD_BAD_VALUE = 2;
+const uint8_t CMD_UNKNOWN = 3;
+
+const uint8_t FRAME_HEADER_SIZE = 2;  // opcode, seq
+const uint8_t FRAME_CRC_SIZE = 2;
+const uint8_t FRAME_MAX_SIZE = FRAME_HEADER_SIZE + SERIAL_FRAME_MAX_PAYLOAD + FRAME_CRC_SIZE;
+const uint8_t FRAME_MAX_ENCODED = FRAME_MAX_SIZE + 1;  // COBS adds one byte per 254
+
+// ==================== CRC / COBS ====================
+
+/**
+ * CRC-16/CCITT-FALSE, bitwise (no 512-byte table on the Uno)
+ */
+uint16_t crc16(const uint8_t* data, uint8_t length) {
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * COBS-encode a frame (without the 0x00 delimiter)
+ * @param output At least length + 1 bytes for frames under 254 bytes
+ * @return Encoded length
+ */
+uint8_t cobsEncode(const uint8_t* input, uint8_t length, uint8_t* output) {
+    uint8_t codeIndex = 0;
+    uint8_t out = 1;
+    uint8_t code = 1;
+    for (uint8_t i = 0; i < length; i++) {
+        if (input[i] == 0) {
+            output[codeIndex] = code;
+            codeIndex = out++;
+            code = 1;
+        } else {
+            output[out++] = input[i];
+            if (++code == 0xFF) {
+                output[codeIndex] = code;
+                codeIndex = out++;
+                code = 1;
+            }
+        }
+    }
+    output[codeIndex] = code;
+    return out;
+}
+
+/**
+ * COBS-decode in place (the decoded frame is never longer than the input)
+ * @return Decoded length, 0 if the encoding is invalid
+ */
+uint8_t cobsDecode(uint8_t* data, uint8_t length) {
+    uint8_t in = 0;
+    uint8_t out = 0;
+    while (in < length) {
+        uint8_t code = data[in++];
+        if (code == 0 || in + code - 1 > length) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            data[out++] = data[in++];
+        }
+        if (code < 0xFF && in < length) {
+            data[out++] = 0;
+        }
+    }
+    return out;
+}
+
+// ==================== FRAME RECEIVER ====================
+
+/**
+ * Byte-at-a-time frame assembly into a static buffer, like LineAssembler
+ */
+struct FrameAssembler {
+    uint8_t buffer[FRAME_MAX_ENCODED];
+    uint8_t length;
+    bool discarding;        // Overlong frame: skipping to the next 0x00
+    uint16_t errors;        // Overlong, badly encoded or CRC-failed frames
+    uint16_t lostFrames;    // Gaps in the CUS sequence numbers
+    bool hasSeq;
+    uint8_t lastSeq;
+};
+
+/**
+ * Feed one received byte
+ * @return Length of the decoded frame (opcode, seq, payload) now at the start
+ *         of buffer, or 0 while incomplete or if the frame was rejected
+ */
+uint8_t assembleFrame(FrameAssembler& frame, uint8_t c) {
+    if (c != 0) {
+        if (frame.discarding) {
+            return 0;
+        }
+        if (frame.length >= FRAME_MAX_ENCODED) {
+            frame.discarding = true;
+            frame.errors++;
+            return 0;
+        }
+        frame.buffer[frame.length++] = c;
+        return 0;
+    }
+
+    uint8_t encoded = frame.length;
+    bool overlong = frame.discarding;
+    frame.length = 0;
+    frame.discarding = false;
+    if (overlong || encoded == 0) {
+        return 0;
+    }
+
+    uint8_t decoded = cobsDecode(frame.buffer, encoded);
+    if (decoded < FRAME_HEADER_SIZE + FRAME_CRC_SIZE) {
+        frame.errors++;
+        return 0;
+    }
+    decoded -= FRAME_CRC_SIZE;
+    uint16_t crc = frame.buffer[decoded] | ((uint16_t)frame.buffer[decoded + 1] << 8);
+    if (crc != crc16(frame.buffer, decoded)) {
+        frame.errors++;
+        return 0;
+    }
+
+    uint8_t seq = frame.buffer[1];
+    if (frame.hasSeq && seq != (uint8_t)(frame.lastSeq + 1)) {
+        frame.lostFrames += (uint8_t)(seq - frame.lastSeq - 1);
+    }
+    frame.hasSeq = true;
+    frame.lastSeq = seq;
+    return decoded;
+}
+
+// ==================== FRAME SENDER ====================
+
+uint8_t txSeq = 0;
+
+/**
+ * Send one frame (payload at most SERIAL_FRAME_MAX_PAYLOAD bytes)
+ */
+void sendFrame(uint8_t opcode, const uint8_t* payload, uint8_t length) {
+    uint8_t raw[FRAME_MAX_SIZE];
+    uint8_t encoded[FRAME_MAX_ENCODED];
+
+    raw[0] = opcode;
+    raw[1] = txSeq++;
+    memcpy(&raw[FRAME_HEADER_SIZE], payload, length);
+    uint8_t size = FRAME_HEADER_SIZE + length;
+    uint16_t crc = crc16(raw, size);
+    raw[size++] = crc & 0xFF;
+    raw[size++] = crc >> 8;
+
+    Serial.write(encoded, cobsEncode(raw, size, encoded));
+    Serial.write((uint8_t)0);
+}
+
+#endif // WCS_PROTOCOL_H
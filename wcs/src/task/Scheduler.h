@@ -0,0 +1,139 @@
+/**
+ * WCS Cooperative Scheduler
+ * loop() runs one pass over a fixed task table, always in table order.
+ * A task runs when its period has elapsed, when another task notified it
+ * (schedulerNotify), or on every pass if it has no period (polled input).
+ * Every run is timed with micros() against the task budget and the whole
+ * pass against SCHED_LOOP_BUDGET_US: the longest pass bounds the button and
+ * CUS command latency.
+ */
+
+#ifndef WCS_SCHEDULER_H
+#define WCS_SCHEDULER_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// ==================== TASK TABLE ====================
+
+/**
+ * Table order: inputs first, then the FSM, then the outputs, so a command or
+ * button press is applied and shown within the same pass. A task may only
+ * notify tasks after it in the table to be run in the same pass.
+ */
+enum TaskId {
+    TASK_SERIAL_RX,     // Polled: CUS commands
+    TASK_BUTTON,        // Polled: mode button
+    TASK_FSM,           // Polled: timeouts, potentiometer, valve target
+    TASK_VALVE,         // Periodic: motion profile step
+    TASK_LCD_RENDER,    // Periodic + event: redraw the framebuffer
+    TASK_LCD_FLUSH,     // Polled: a few LCD bus operations
+    TASK_STATUS,        // Polled: status to CUS on change + keepalive
+    TASK_SCHED_REPORT,  // Periodic: timing report to CUS
+    TASK_COUNT
+};
+
+typedef void (*TaskFunction)();
+
+struct SchedulerTask {
+    const char* name;
+    TaskFunction run;
+    unsigned long periodMs;   // 0 = every pass
+    uint16_t budgetUs;        // Longest acceptable run
+
+    unsigned long releaseMs;  // Last periodic release
+    bool notified;
+    uint16_t maxUs;           // Longest run since boot (saturated)
+    uint16_t overruns;        // Runs over budget + missed periods
+};
+
+struct SchedulerStats {
+    uint16_t loopMaxUs;       // Longest pass since boot (saturated)
+    uint16_t loopOverruns;    // Passes over SCHED_LOOP_BUDGET_US
+};
+
+extern SchedulerTask schedulerTasks[TASK_COUNT];
+SchedulerStats schedulerStats = {};
+
+// ==================== SCHEDULER FUNCTIONS ====================
+
+uint16_t saturateUs(unsigned long us) {
+    return us > 0xFFFF ? 0xFFFF : (uint16_t)us;
+}
+
+/**
+ * Run a task in the current pass (or the next one if it already ran)
+ */
+void schedulerNotify(TaskId id) {
+    schedulerTasks[id].notified = true;
+}
+
+/**
+ * Start every period from now, called at the end of setup()
+ */
+void schedulerStart() {
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < TASK_COUNT; i++) {
+        schedulerTasks[i].releaseMs = now;
+    }
+}
+
+/**
+ * Decide whether a task runs in this pass
+ * Periods are kept on a fixed grid; a task more than one period late has
+ * missed a release, which counts as an overrun and restarts its grid
+ */
+bool schedulerDue(SchedulerTask& task, unsigned long now) {
+    bool due = task.notified;
+    task.notified = false;
+
+    if (task.periodMs == 0) {
+        return true;
+    }
+    unsigned long late = now - task.releaseMs;
+    if (late < task.periodMs) {
+        return due;
+    }
+    if (late >= 2 * task.periodMs) {
+        task.overruns++;
+        task.releaseMs = now;
+    } else {
+        task.releaseMs += task.periodMs;
+    }
+    return true;
+}
+
+/**
+ * One pass over the task table, called from loop()
+ */
+void schedulerRun() {
+    unsigned long passStart = micros();
+
+    for (uint8_t i = 0; i < TASK_COUNT; i++) {
+        SchedulerTask& task = schedulerTasks[i];
+        if (!schedulerDue(task, millis())) {
+            continue;
+        }
+
+        unsigned long start = micros();
+        task.run();
+        uint16_t elapsed = saturateUs(micros() - start);
+
+        if (elapsed > task.maxUs) {
+            task.maxUs = elapsed;
+        }
+        if (elapsed > task.budgetUs) {
+            task.overruns++;
+        }
+    }
+
+    uint16_t pass = saturateUs(micros() - passStart);
+    if (pass > schedulerStats.loopMaxUs) {
+        schedulerStats.loopMaxUs = pass;
+    }
+    if (pass > SCHED_LOOP_BUDGET_US) {
+        schedulerStats.loopOverruns++;
+    }
+}
+
+#endif // WCS_SCHEDULER_H
@@ -1,19 +1,109 @@
 /**
  * WCS Serial Communication
- * Serial communication with CUS (JSON protocol)
+ * Serial communication with CUS: JSON lines at SERIAL_BAUD, switched to
+ * binary frames (Protocol.h) at a higher baud rate when the CUS asks for it
+ *
+ * Negotiation, always started by the CUS over JSON:
+ *   CUS: {"cmd":"hello","proto":1,"baud":250000}
+ *   WCS: {"hello":1,"baud":250000}   (baud = the one it switches to)
+ * Both sides then use binary frames at that baud rate. A CUS that never
+ * says hello keeps the JSON protocol. After CUS_TIMEOUT_MS without a valid
+ * frame the WCS returns to JSON at SERIAL_BAUD so a restarted CUS can
+ * negotiate again.
  */
 
 #ifndef WCS_SERIAL_COMM_H
 #define WCS_SERIAL_COMM_H
 
 #include <Arduino.h>
-#include <ArduinoJson.h>
 #include "Config.h"
 #include "FSM.h"
 #include "ServoControl.h"
+#include "Protocol.h"
+#include "Scheduler.h"
+#include "LocalControl.h"
 
 // Timing
-extern unsigned long lastSerialUpdate;
+extern unsigned long ignorePotUntil;
+
+// ==================== LINK STATE ====================
+
+enum LinkProtocol {
+    LINK_JSON,     // Text lines, always available as fallback
+    LINK_BINARY    // COBS frames, after a hello
+};
+
+LinkProtocol linkProtocol = LINK_JSON;
+unsigned long linkBaud = SERIAL_BAUD;
+FrameAssembler serialFrame = {};
+
+/**
+ * Last status sent to the CUS: a new one goes out when any field differs
+ * (at most every SERIAL_STATUS_MIN_INTERVAL_MS) or after SERIAL_KEEPALIVE_MS
+ */
+struct StatusReport {
+    uint16_t seq;              // Incremented per status sent, wraps
+    unsigned long sentMs;
+    bool forced;               // Send on the next pass whatever changed
+    SystemMode mode;
+    uint8_t valve;
+    uint8_t command;
+    uint16_t rxErrors;
+};
+
+StatusReport statusReport = { 0, 0, true };
+
+// ==================== LINE ASSEMBLER ====================
+
+/**
+ * Incremental command line assembly into a static buffer
+ * Bytes are consumed as they arrive, so a partial line never blocks loop();
+ * a line longer than the buffer is discarded up to the next newline
+ */
+struct LineAssembler {
+    char buffer[SERIAL_LINE_BUFFER_SIZE];
+    uint8_t length;
+    bool discarding;          // Overlong line: skipping to the next '\n'
+    uint16_t framingErrors;   // Overlong lines dropped
+};
+
+LineAssembler serialLine = {};
+
+/**
+ * Feed one received byte
+ * @return true when a complete, non-empty line is in buffer (NUL-terminated, trimmed)
+ */
+bool assembleLine(LineAssembler& line, char c) {
+    if (c == '\n') {
+        bool overlong = line.discarding;
+        line.discarding = false;
+        
+        // Trailing whitespace (\r included), as String::trim did
+        while (line.length > 0 && isspace((unsigned char)line.buffer[line.length - 1])) {
+            line.length--;
+        }
+        line.buffer[line.length] = '\0';
+        if (overlong || line.length == 0) {
+            line.length = 0;
+            return false;
+        }
+        return true;
+    }
+    
+    if (line.discarding || (line.length == 0 && isspace((unsigned char)c))) {
+        return false;
+    }
+    
+    if (line.length >= SERIAL_LINE_BUFFER_SIZE - 1) {
+        line.discarding = true;
+        line.length = 0;
+        line.framingErrors++;
+        return false;
+    }
+    
+    line.buffer[line.length++] = c;
+    return false;
+}
 
 // ==================== SERIAL COMMUNICATION FUNCTIONS ====================
 
@@ -28,87 +118,441 @@ void setupSerial() {
 }
 
 /**
- * Process incoming JSON command from CUS
- * @param command JSON command string
+ * Receive errors of both framings, reported in the status
  */
-void processSerialCommand(const String& command) {
-    // Parse JSON command from CUS
-    StaticJsonDocument<200> doc;
-    DeserializationError error = deserializeJson(doc, command);
+uint16_t serialRxErrors() {
+    return serialLine.framingErrors + serialFrame.errors;
+}
+
+/**
+ * Valve command from CUS (either protocol)
+ * @return CMD_OK, or CMD_UNCONNECTED (not applied)
+ */
+uint8_t applyValveCommand(int value) {
+    if (currentMode == MODE_UNCONNECTED) {
+        return CMD_UNCONNECTED;
+    }
+    targetValvePercentage = constrain(value, 0, 100);
+    // Ignore potentiometer for 1 second to avoid noise/fighting
+    ignorePotUntil = millis() + 1000;
+    deferToCUSCommand();
+    return CMD_OK;
+}
+
+/**
+ * Mode command from CUS (either protocol)
+ * AUTOMATIC keeps MODE_LOCAL: local control is the CUS policy run here
+ * @return CMD_OK, or CMD_BAD_VALUE for a mode the CUS cannot set
+ */
+uint8_t applyModeCommand(SystemMode mode) {
+    if (mode != MODE_AUTOMATIC && mode != MODE_MANUAL) {
+        return CMD_BAD_VALUE;
+    }
+    if (!(mode == MODE_AUTOMATIC && currentMode == MODE_LOCAL)) {
+        handleModeTransition(mode);
+    }
+    return CMD_OK;
+}
+
+/**
+ * Answer a command that carried an id (either protocol)
+ * JSON: {"ack":17,"value":50,"us":184} or {"nack":17,"reason":"unconnected","value":0,"us":96}
+ * @param value Applied value: commanded valve percentage or current mode
+ * @param startUs micros() when the command was complete
+ */
+void sendCommandReply(uint16_t id, uint8_t result, uint8_t value, unsigned long startUs) {
+    uint16_t us = saturateUs(micros() - startUs);
     
-    if (error) {
-        Serial.print("JSON parse error: ");
-        Serial.println(error.c_str());
+    if (linkProtocol == LINK_BINARY) {
+        uint8_t payload[6] = {
+            (uint8_t)(id & 0xFF), (uint8_t)(id >> 8), result, value,
+            (uint8_t)(us & 0xFF), (uint8_t)(us >> 8)
+        };
+        sendFrame(OP_ACK, payload, sizeof(payload));
         return;
     }
     
-    const char* cmd = doc["cmd"];
+    static const char* const REASONS[] = { "ok", "unconnected", "bad_value", "unknown" };
+    if (result == CMD_OK) {
+        Serial.print("{\"ack\":");
+        Serial.print(id);
+    } else {
+        Serial.print("{\"nack\":");
+        Serial.print(id);
+        Serial.print(",\"reason\":\"");
+        Serial.print(result <= CMD_UNKNOWN ? REASONS[result] : "?");
+        Serial.print('"');
+    }
+    Serial.print(",\"value\":");
+    Serial.print(value);
+    Serial.print(",\"us\":");
+    Serial.print(us);
+    Serial.println("}");
+}
+
+/**
+ * Switch protocol and baud rate (pending output is sent at the old rate first)
+ */
+void setLinkProtocol(LinkProtocol protocol, unsigned long baud) {
+    Serial.flush();
+    if (baud != linkBaud) {
+        Serial.end();
+        Serial.begin(baud);
+        linkBaud = baud;
+    }
+    linkProtocol = protocol;
+    serialLine.length = 0;
+    serialLine.discarding = false;
+    serialFrame.length = 0;
+    serialFrame.discarding = false;
+    serialFrame.hasSeq = false;
+    statusReport.forced = true;  // Tell the CUS the state on the new link
+}
+
+/**
+ * Baud rates offered to the CUS (exact or within 2.1% on a 16 MHz Uno)
+ */
+bool isSupportedBaud(unsigned long baud) {
+    return baud <= SERIAL_MAX_BAUD &&
+           (baud == 9600 || baud == 57600 || baud == 115200 ||
+            baud == 250000 || baud == 500000 || baud == 1000000);
+}
+
+// ==================== JSON PROTOCOL ====================
+
+/**
+ * Find the value of a key in a flat JSON object
+ * Enough for the CUS commands, without a JSON document on the Uno
+ * @return Pointer to the first character of the value, or NULL
+ */
+const char* jsonValue(const char* json, const char* key) {
+    size_t keyLength = strlen(key);
+    for (const char* p = strchr(json, '"'); p != NULL; p = strchr(p + 1, '"')) {
+        if (strncmp(p + 1, key, keyLength) != 0 || p[keyLength + 1] != '"') {
+            continue;
+        }
+        p += keyLength + 2;
+        while (*p == ' ') {
+            p++;
+        }
+        if (*p != ':') {
+            continue;
+        }
+        p++;
+        while (*p == ' ') {
+            p++;
+        }
+        return p;
+    }
+    return NULL;
+}
+
+/**
+ * Compare a JSON string value
+ */
+bool jsonStringIs(const char* value, const char* expected) {
+    size_t length = strlen(expected);
+    return value != NULL && value[0] == '"' &&
+           strncmp(value + 1, expected, length) == 0 && value[length + 1] == '"';
+}
+
+/**
+ * Parse a JSON number value (integer part)
+ * @return false if the value is missing or not a number (a string, null, ...)
+ */
+bool jsonInteger(const char* value, long& result) {
+    if (value == NULL) {
+        return false;
+    }
+    char* end;
+    result = strtol(value, &end, 10);
+    return end != value;
+}
+
+/**
+ * Answer a hello: acknowledge in JSON, then switch to binary frames
+ */
+void acceptHello(const char* command) {
+    const char* proto = jsonValue(command, "proto");
+    if (proto == NULL || atoi(proto) != LINK_PROTOCOL_VERSION) {
+        return;  // Unknown version: stay on JSON
+    }
+    const char* requested = jsonValue(command, "baud");
+    unsigned long baud = requested != NULL ? strtoul(requested, NULL, 10) : SERIAL_BAUD;
+    if (!isSupportedBaud(baud)) {
+        baud = SERIAL_BAUD;
+    }
+    
+    Serial.print("{\"hello\":");
+    Serial.print(LINK_PROTOCOL_VERSION);
+    Serial.print(",\"baud\":");
+    Serial.print(baud);
+    Serial.println("}");
+    setLinkProtocol(LINK_BINARY, baud);
+}
+
+/**
+ * Process incoming JSON command from CUS
+ * @param command JSON command string
+ */
+void processSerialCommand(const char* command) {
+    unsigned long startUs = micros();
+    const char* cmd = jsonValue(command, "cmd");
+    if (cmd == NULL) {
+        return;
+    }
+    const char* id = jsonValue(command, "id");  // Optional: only commands with an id are answered
+    uint8_t result = CMD_UNKNOWN;
+    uint8_t applied = 0;
     
-    if (strcmp(cmd, "set_valve") == 0) {
+    if (jsonStringIs(cmd, "set_valve")) {
         // Command to set valve percentage
-        int value = doc["value"];
+        long value;
+        result = jsonInteger(jsonValue(command, "value"), value) ? applyValveCommand(value) : CMD_BAD_VALUE;
+        applied = (uint8_t)targetValvePercentage;
         
-        if (currentMode != MODE_UNCONNECTED) {
-            targetValvePercentage = value;
-            // Ignore potentiometer for 1 second to avoid noise/fighting
-            ignorePotUntil = millis() + 1000;
-        }
-        
-    } else if (strcmp(cmd, "set_mode") == 0) {
+    } else if (jsonStringIs(cmd, "set_mode")) {
         // Command to change mode
-        const char* mode = doc["value"];
+        const char* mode = jsonValue(command, "value");
         
-        if (strcmp(mode, "AUTOMATIC") == 0) {
-            handleModeTransition(MODE_AUTOMATIC);
-        } else if (strcmp(mode, "MANUAL") == 0) {
-            handleModeTransition(MODE_MANUAL);
+        if (jsonStringIs(mode, "AUTOMATIC")) {
+            result = applyModeCommand(MODE_AUTOMATIC);
+        } else if (jsonStringIs(mode, "MANUAL")) {
+            result = applyModeCommand(MODE_MANUAL);
+        } else {
+            result = CMD_BAD_VALUE;
         }
+        applied = (uint8_t)currentMode;
+        
+    } else if (jsonStringIs(cmd, "level")) {
+        // Level sample forwarded by the CUS: {"cmd":"level","value":3012} (0.1 mm)
+        const char* value = jsonValue(command, "value");
+        if (value != NULL) {
+            applyLevelSample((uint16_t)strtoul(value, NULL, 10));
+            result = CMD_OK;
+        } else {
+            result = CMD_BAD_VALUE;
+        }
+        
+    } else if (jsonStringIs(cmd, "policy")) {
+        // {"cmd":"policy","l1":2000,"l2":4000,"t1":10000} (0.1 mm, ms)
+        const char* l1 = jsonValue(command, "l1");
+        const char* l2 = jsonValue(command, "l2");
+        const char* t1 = jsonValue(command, "t1");
+        bool accepted = l1 != NULL && l2 != NULL && t1 != NULL &&
+            applyLocalPolicy((uint16_t)strtoul(l1, NULL, 10), (uint16_t)strtoul(l2, NULL, 10),
+                             strtoul(t1, NULL, 10));
+        result = accepted ? CMD_OK : CMD_BAD_VALUE;
+        applied = (uint8_t)currentMode;  // As for set_mode: shows whether local control runs
+        
+    } else if (jsonStringIs(cmd, "hello")) {
+        acceptHello(command);
+        return;
+    } else if (jsonStringIs(cmd, "ping")) {
+        return;
+    }
+    
+    if (id != NULL) {
+        sendCommandReply((uint16_t)strtoul(id, NULL, 10), result, applied, startUs);
+    }
+}
+
+// ==================== BINARY PROTOCOL ====================
+
+/**
+ * Process a decoded frame from CUS (opcode, seq, payload)
+ */
+void processSerialFrame(const uint8_t* frame, uint8_t length) {
+    unsigned long startUs = micros();
+    const uint8_t* payload = &frame[FRAME_HEADER_SIZE];
+    uint8_t payloadLength = length - FRAME_HEADER_SIZE;
+    uint8_t result;
+    uint8_t applied;
+    
+    switch (frame[0]) {
+        case OP_SET_VALVE:
+            result = payloadLength >= 1 ? applyValveCommand(payload[0]) : CMD_BAD_VALUE;
+            applied = (uint8_t)targetValvePercentage;
+            break;
+        case OP_SET_MODE:
+            result = payloadLength >= 1 ? applyModeCommand((SystemMode)payload[0]) : CMD_BAD_VALUE;
+            applied = (uint8_t)currentMode;
+            break;
+        case OP_LEVEL:
+            if (payloadLength >= 2) {
+                applyLevelSample(payload[0] | ((uint16_t)payload[1] << 8));
+            }
+            return;  // Never answered: the next sample replaces a lost one
+        case OP_SET_POLICY:
+            if (payloadLength >= 8) {
+                applyLocalPolicy(payload[0] | ((uint16_t)payload[1] << 8),
+                                 payload[2] | ((uint16_t)payload[3] << 8),
+                                 payload[4] | ((uint32_t)payload[5] << 8) |
+                                 ((uint32_t)payload[6] << 16) | ((uint32_t)payload[7] << 24));
+            }
+            return;  // Resent periodically by the CUS
+        default:
+            return;  // OP_PING and unknown opcodes only refresh the link
+    }
+    
+    // Command id after the one-byte argument
+    if (payloadLength >= 3) {
+        sendCommandReply(payload[1] | ((uint16_t)payload[2] << 8), result, applied, startUs);
+    }
+}
+
+// ==================== INPUT / OUTPUT ====================
+
+/**
+ * A complete message arrived from CUS
+ */
+void onCUSMessage() {
+    lastCUSMessageTime = millis();  // Reset timeout
+    
+    // If we were unconnected, transition to automatic
+    if (currentMode == MODE_UNCONNECTED) {
+        handleModeTransition(MODE_AUTOMATIC);
     }
 }
 
 /**
  * Handle incoming serial data
+ * Only consumes the bytes already received and stops after one complete
+ * message, so each call is bounded by the RX buffer size plus one command
  */
 void handleSerialInput() {
-    if (Serial.available() > 0) {
-        String command = Serial.readStringUntil('\n');
-        command.trim();
+    if (linkProtocol == LINK_BINARY && millis() - lastCUSMessageTime > CUS_TIMEOUT_MS) {
+        setLinkProtocol(LINK_JSON, SERIAL_BAUD);
+    }
+    
+    while (Serial.available() > 0) {
+        uint8_t c = (uint8_t)Serial.read();
         
-        if (command.length() > 0) {
-            processSerialCommand(command);
-            lastCUSMessageTime = millis();  // Reset timeout
-            
-            // If we were unconnected, transition to automatic
-            if (currentMode == MODE_UNCONNECTED) {
-                handleModeTransition(MODE_AUTOMATIC);
+        if (linkProtocol == LINK_BINARY) {
+            uint8_t length = assembleFrame(serialFrame, c);
+            if (length == 0) {
+                continue;
             }
+            processSerialFrame(serialFrame.buffer, length);
+        } else {
+            if (!assembleLine(serialLine, (char)c)) {
+                continue;
+            }
+            processSerialCommand(serialLine.buffer);
+            serialLine.length = 0;
         }
+        onCUSMessage();
+        return;
     }
 }
 
 /**
- * Send current status to CUS in JSON format
+ * Send current status to CUS (JSON line or STATUS frame)
+ * valve is the estimated actual opening, cmd the commanded one,
+ * seq the status sequence number (gaps = lost status messages)
  */
 void sendStatusToSerial() {
-    // Send current status to CUS in JSON format
-    StaticJsonDocument<200> doc;
+    StatusReport& report = statusReport;
+    report.seq++;
+    report.sentMs = millis();
+    report.forced = false;
+    report.mode = currentMode;
+    report.valve = (uint8_t)currentValvePercentage;
+    report.command = (uint8_t)commandedValvePercentage();
+    report.rxErrors = serialRxErrors();
     
+    if (linkProtocol == LINK_BINARY) {
+        uint8_t payload[7] = {
+            (uint8_t)report.mode, report.valve,
+            (uint8_t)(report.rxErrors & 0xFF), (uint8_t)(report.rxErrors >> 8),
+            report.command,
+            (uint8_t)(report.seq & 0xFF), (uint8_t)(report.seq >> 8)
+        };
+        sendFrame(OP_STATUS, payload, sizeof(payload));
+        return;
+    }
+    
+    Serial.print("{\"mode\":\"");
     switch (currentMode) {
         case MODE_UNCONNECTED:
-            doc["mode"] = "UNCONNECTED";
+            Serial.print("UNCONNECTED");
             break;
         case MODE_AUTOMATIC:
-            doc["mode"] = "AUTOMATIC";
+            Serial.print("AUTOMATIC");
             break;
         case MODE_MANUAL:
-            doc["mode"] = "MANUAL";
+            Serial.print("MANUAL");
             break;
+        case MODE_LOCAL:
+            Serial.print("LOCAL");
+            break;
+    }
+    Serial.print("\",\"valve\":");
+    Serial.print(currentValvePercentage);
+    Serial.print(",\"cmd\":");
+    Serial.print(commandedValvePercentage());
+    if (report.rxErrors > 0) {
+        Serial.print(",\"rx_err\":");
+        Serial.print(report.rxErrors);
     }
+    Serial.print(",\"seq\":");
+    Serial.print(report.seq);
+    Serial.println("}");  // End of JSON message
+}
+
+/**
+ * Scheduler task: send the status when it changed, or as a keepalive
+ * A mode change or a new valve position is reported in the same pass;
+ * while the valve moves, updates are spaced by SERIAL_STATUS_MIN_INTERVAL_MS
+ */
+void updateStatusReport() {
+    const StatusReport& report = statusReport;
+    unsigned long sinceLast = millis() - report.sentMs;
     
-    doc["valve"] = currentValvePercentage;
+    bool changed = report.forced ||
+        report.mode != currentMode ||
+        report.valve != currentValvePercentage ||
+        report.command != commandedValvePercentage() ||
+        report.rxErrors != serialRxErrors();
+    
+    if ((changed && sinceLast >= SERIAL_STATUS_MIN_INTERVAL_MS) || sinceLast >= SERIAL_KEEPALIVE_MS) {
+        sendStatusToSerial();
+    }
+}
+
+/**
+ * Report the timing of one scheduler task (next one on each call) with the
+ * loop totals; one short message keeps the blocking time on the TX buffer low
+ * JSON: {"sched":"valve","max":184,"ovr":0,"loop":2140,"lovr":0} (us)
+ */
+void sendSchedulerReport() {
+    static uint8_t next = 0;
+    const SchedulerTask& task = schedulerTasks[next];
+    
+    if (linkProtocol == LINK_BINARY) {
+        uint8_t payload[8] = {
+            next,
+            (uint8_t)(task.maxUs & 0xFF), (uint8_t)(task.maxUs >> 8),
+            (uint8_t)(task.overruns > 0xFF ? 0xFF : task.overruns),
+            (uint8_t)(schedulerStats.loopMaxUs & 0xFF), (uint8_t)(schedulerStats.loopMaxUs >> 8),
+            (uint8_t)(schedulerStats.loopOverruns & 0xFF), (uint8_t)(schedulerStats.loopOverruns >> 8)
+        };
+        sendFrame(OP_SCHED, payload, sizeof(payload));
+    } else {
+        Serial.print("{\"sched\":\"");
+        Serial.print(task.name);
+        Serial.print("\",\"max\":");
+        Serial.print(task.maxUs);
+        Serial.print(",\"ovr\":");
+        Serial.print(task.overruns);
+        Serial.print(",\"loop\":");
+        Serial.print(schedulerStats.loopMaxUs);
+        Serial.print(",\"lovr\":");
+        Serial.print(schedulerStats.loopOverruns);
+        Serial.println("}");
+    }
     
-    serializeJson(doc, Serial);
-    Serial.println();  // End of JSON message
+    next = (next + 1) % TASK_COUNT;
 }
 
 #endif // WCS_SERIAL_COMM_H
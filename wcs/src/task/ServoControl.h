@@ -1,6 +1,6 @@
 /**
  * WCS Servo Control
- * Valve control and servo management
+ * Valve control and servo management, with a non-blocking motion profile
  */
 
 #ifndef WCS_SERVO_CONTROL_H
@@ -14,7 +14,7 @@
 extern Servo valveServo;
 
 // Global valve state
-extern int currentValvePercentage;
+extern int currentValvePercentage;   // Estimated actual opening
 extern int targetValvePercentage;
 
 // ==================== SERVO CONTROL FUNCTIONS ====================
@@ -28,16 +28,104 @@ int percentageToAngle(int percentage) {
     return map(percentage, 0, 100, VALVE_MIN_ANGLE, VALVE_MAX_ANGLE);
 }
 
+// ==================== MOTION PROFILE ====================
+
+/**
+ * Trapezoidal valve motion in 0.01 % units (integer only, no FPU on the Uno)
+ * The speed is limited by VALVE_SLEW_RATE_PCT_S and changes by at most
+ * VALVE_ACCEL_PCT_S2; near the target it is capped to sqrt(2 * a * distance)
+ * so the valve decelerates into the target instead of overshooting
+ */
+struct ValveMotion {
+    int32_t position;          // Estimated actual position (0.01 %)
+    int32_t velocity;          // 0.01 %/s, signed
+    uint8_t target;            // Commanded percentage
+    int lastAngle;             // Last angle written to the servo
+    unsigned long lastStepMs;
+};
+
+ValveMotion valveMotion = {};
+
+const int32_t VALVE_SLEW_RATE = (int32_t)VALVE_SLEW_RATE_PCT_S * 100;
+const int32_t VALVE_ACCEL = (int32_t)VALVE_ACCEL_PCT_S2 * 100;
+
+/**
+ * Integer square root (floor)
+ */
+uint32_t isqrt32(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
 /**
  * Set valve to specified percentage
+ * Only retargets the motion; valveMotionStep moves the servo there
  * @param percentage Valve opening percentage (0-100)
  */
 void setValvePercentage(int percentage) {
-    percentage = constrain(percentage, 0, 100);
-    int angle = percentageToAngle(percentage);
+    valveMotion.target = constrain(percentage, 0, 100);
+}
+
+/**
+ * Commanded valve opening (where the valve is going)
+ */
+int commandedValvePercentage() {
+    return valveMotion.target;
+}
+
+/**
+ * Advance the motion profile, run by the scheduler every VALVE_STEP_MS
+ * Integrates over the time actually elapsed and only writes the servo when
+ * the angle changes; currentValvePercentage follows the estimated position
+ */
+void valveMotionStep() {
+    unsigned long now = millis();
+    unsigned long elapsed = now - valveMotion.lastStepMs;
+    valveMotion.lastStepMs = now;
+    int32_t dtMs = (int32_t)(elapsed < 100 ? elapsed : 100);  // Bound the step after a stall
+    
+    int32_t error = (int32_t)valveMotion.target * 100 - valveMotion.position;
+    int32_t distance = error < 0 ? -error : error;
+    
+    int32_t speed = (int32_t)isqrt32(2UL * (uint32_t)VALVE_ACCEL * (uint32_t)distance);
+    if (speed > VALVE_SLEW_RATE) {
+        speed = VALVE_SLEW_RATE;
+    }
+    int32_t desired = error < 0 ? -speed : speed;
+    
+    int32_t maxChange = VALVE_ACCEL * dtMs / 1000;
+    int32_t change = constrain(desired - valveMotion.velocity, -maxChange, maxChange);
+    valveMotion.velocity += change;
+    
+    int32_t move = valveMotion.velocity * dtMs / 1000;
+    if ((error >= 0 && move >= error) || (error <= 0 && move <= error)) {
+        // Target reached within this step
+        valveMotion.position = (int32_t)valveMotion.target * 100;
+        valveMotion.velocity = 0;
+    } else {
+        valveMotion.position += move;
+    }
     
-    valveServo.write(angle);
-    currentValvePercentage = percentage;
+    currentValvePercentage = (valveMotion.position + 50) / 100;
+    int angle = VALVE_MIN_ANGLE +
+        (int)((valveMotion.position * (int32_t)(VALVE_MAX_ANGLE - VALVE_MIN_ANGLE) + 5000) / 10000);
+    if (angle != valveMotion.lastAngle) {
+        valveServo.write(angle);
+        valveMotion.lastAngle = angle;
+    }
 }
 
 /**
@@ -45,7 +133,12 @@ void setValvePercentage(int percentage) {
  */
 void setupServo() {
     valveServo.attach(SERVO_PIN);
-    setValvePercentage(0);  // Start with valve closed
+    // Start with valve closed (the real position at power-on is unknown, so no ramp)
+    setValvePercentage(0);
+    valveMotion.position = 0;
+    valveMotion.lastAngle = percentageToAngle(0);
+    valveServo.write(valveMotion.lastAngle);
+    currentValvePercentage = 0;
     Serial.println("Servo initialized (valve closed)");
 }
 